@@ -2,21 +2,145 @@
 #include <iostream>
 #include <cstdlib>
 #include <filesystem>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <system_error>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <array>
+#include <iomanip>
+#include <mutex>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include <cerrno>
+
+#ifdef _WIN32
+#define NOMINMAX            // keeps windows.h from turning min and max into macros
+#include <windows.h>        // GetModuleFileNameW, WideCharToMultiByte
+#include <shellapi.h>       // CommandLineToArgvW
+#include <io.h>             // _wopen, _write, _get_osfhandle, _commit (fsync on windows)
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>          // open, posix_fallocate, fsync
+#include <unistd.h>         // pwrite, lchown, geteuid
+#include <sys/stat.h>       // stat, to find who owns a home folder
+#include <sys/mman.h>       // mmap, for patching vp8 first pass logs in place
+#endif
 
 using namespace std;
 
-void make_mpv_conf_file(string path_upto_username){
+constexpr uint64_t content_hash(const char* text, size_t size, uint64_t hash = 14695981039346656037ull){ // 64 bit FNV-1a. simple enough for the compiler to run it on our raw strings
+    for (size_t i = 0; i < size; i++){
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;                                    // pass the result back in as "hash" to keep hashing a file piece by piece
+}
 
-    ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\mpv.conf" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
+
+// the raw strings below are never stored in the exe as they are. the compiler packs each one with lz_pack and only the packed bytes end up in the exe.
+// packed format: a flag byte, then 8 tokens. bit t of the flag byte says what token t is:
+//     0 -> one plain byte
+//     1 -> 3 bytes: distance back (16 bit, little endian) and length - min_match. copy length bytes from that far back in the output
+// (with -O0 the compiler keeps the raw strings around anyway, build with -O2 for the small exe)
+
+constexpr size_t match_window = 65535;              // how far back a copy can reach
+constexpr size_t min_match = 4;                     // a copy is 3 bytes, so shorter ones don't save anything
+constexpr size_t max_match = 255 + min_match;
+constexpr int match_hash_bits = 13;
+
+constexpr size_t lz_pack_into(const char* text, size_t size, unsigned char* out){ // packs text into out and returns the packed size. out == nullptr only counts
+    array<uint32_t, (1u << match_hash_bits)> last_seen{};   // position + 1 where each 4 byte hash was seen last, 0 = never
+    size_t written = 0, flag_at = 0, tokens = 8;
+
+    for (size_t i = 0; i < size; tokens++){
+        if (tokens == 8){                           // new group, its flag byte starts as all plain bytes
+            flag_at = written;
+            if (out) out[written] = 0;
+            written++;
+            tokens = 0;
+        }
+
+        size_t length = 0, distance = 0;
+        if (i + min_match <= size){
+            uint32_t four_bytes = (uint32_t)(unsigned char)text[i] | (uint32_t)(unsigned char)text[i+1] << 8 |
+                                  (uint32_t)(unsigned char)text[i+2] << 16 | (uint32_t)(unsigned char)text[i+3] << 24;
+            uint32_t slot = four_bytes * 2654435761u >> (32 - match_hash_bits);
+            size_t candidate = last_seen[slot];
+            last_seen[slot] = (uint32_t)(i + 1);
+            if (candidate != 0 && i - (candidate - 1) <= match_window){
+                size_t from = candidate - 1;
+                while (i + length < size && length < max_match && text[from + length] == text[i + length]){
+                    length++;
+                }
+                distance = i - from;
+            }
+        }
+
+        if (length >= min_match){
+            if (out){
+                out[flag_at] |= (unsigned char)(1u << tokens);
+                out[written] = (unsigned char)(distance & 0xff);
+                out[written+1] = (unsigned char)(distance >> 8);
+                out[written+2] = (unsigned char)(length - min_match);
+            }
+            written += 3;
+            i += length;
+        }
+        else{
+            if (out) out[written] = (unsigned char)text[i];
+            written++;
+            i++;
+        }
     }
+    return written;
+}
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
+template <size_t packed_size>
+constexpr array<unsigned char, packed_size> lz_pack(const char* text, size_t size){
+    array<unsigned char, packed_size> packed{};
+    lz_pack_into(text, size, packed.data());
+    return packed;
+}
+
+template <const auto& source>
+struct packed_text{                                 // packs a raw string once, into exactly as many bytes as it needs
+    static constexpr size_t size = sizeof(source) - 1;              // without the '\0' at the end
+    static constexpr auto bytes = lz_pack<lz_pack_into(source, size, nullptr)>(source, size);
+};
+
+
+struct embedded_asset{                              // one of the files we carry inside the exe
+    const char* name;                               // like "mpv.conf", also used to look the asset up
+    const char* relative_path;                      // where the file goes inside the mpv config folder
+    size_t size;                                    // unpacked size
+    uint64_t hash;                                  // content_hash of the unpacked text
+    const unsigned char* packed;
+    size_t packed_size;
+};
+
+template <const auto& source>
+constexpr embedded_asset make_embedded_asset(const char* name, const char* relative_path){
+    return { name, relative_path, packed_text<source>::size, content_hash(source, packed_text<source>::size),
+             packed_text<source>::bytes.data(), packed_text<source>::bytes.size() };
+}
 
-    file_writer<<R"(# cmd = mpv --no-config -sub-font="Gandhi Sans" -sub-font-size=48 -sub-bold=yes -sub-border-color=0.0/0.0/0.0/1.0 -sub-border-size=2.2 -sub-shadow-color=0.0/0.0/0.0/0.6 -sub-shadow-offset=1.2 -sub-margin-x=90 -sub-margin-y=38 -sub-fix-timing=yes "D:\Movies\UN-WATCHED\Prisoners.2013.720p.Brrip.x265.HEVC.10bit.PoOlLa.mkv" 
+
+// raw string syntax is rawstring = R"(ghuiyanlassan)" 
+// raw string keep the \n,\t and other thing as same it is without conveying any meaning
+// here we would have to use a delimiter that we used is x between " and ( beacuse our string contains this : )" 
+
+// contents of mpv.conf
+constexpr char mpv_conf_source[] = R"(# cmd = mpv --no-config -sub-font="Gandhi Sans" -sub-font-size=48 -sub-bold=yes -sub-border-color=0.0/0.0/0.0/1.0 -sub-border-size=2.2 -sub-shadow-color=0.0/0.0/0.0/0.6 -sub-shadow-offset=1.2 -sub-margin-x=90 -sub-margin-y=38 -sub-fix-timing=yes "D:\Movies\UN-WATCHED\Prisoners.2013.720p.Brrip.x265.HEVC.10bit.PoOlLa.mkv" 
 
 ################################
 #        MISC Settings         #
@@ -144,21 +268,10 @@ osd-shadow-color=0.0/0.0/0.0/0.6             # transparent shadow.  in r/g/b/a f
 osd-shadow-offset=0.7                        # shadow is a must. but not too much!
 
 )";
-    cout<<"successfully created mpv.conf... "<<endl;
-}
-
 
-void make_input_conf_file(string path_upto_username){
-    ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\input.conf" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
-    }
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
-
-    file_writer<<R"(# Volume
+// contents of input.conf
+constexpr char input_conf_source[] = R"(# Volume
 # ======
 WHEEL_UP add volume 5
 WHEEL_DOWN add volume -5
@@ -193,21 +306,10 @@ d cycle deband
 
 
 R cycle_values video-rotate 90 180 270 0)";
-    cout<<"successfully created input.conf... "<<endl;
-}
 
 
-void make_notes_txt_file(string path_upto_username){
-        ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\notes.txt" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
-    }
-
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
-    // here we would have to use a delimiter that we used is x between " and ( beacuse our string contains this : )" 
-    file_writer<<R"x(###########
+// contents of notes.txt
+constexpr char notes_txt_source[] = R"x(###########
    NOTES
 ###########
 1) mpv.conf file store all the mpv settings. But some settings like "--no-config" can be only applied on command line or terminal. Oh man i miss using linux...
@@ -256,27 +358,17 @@ void make_notes_txt_file(string path_upto_username){
 15) WARNING : if you dont have a graphics card/gpu DONT ever use "profile=gpu-hq" option. every other mpv guide will tell you to do it but you dont because it will cause the video to stutter and will drop several frames resulting in the bad experience. especially if playing some HEVC-10bit heavy stuff.
 
 16) you can't store the screenshots in the "C:\program files" or "C:\program files (x86)" or in "C:\windows" because you don't have admin rights there(because OS files are there) but after log in using your password you can store it in "C:\Users\username\AppData\Roaming\mpv\screenshots" because you have admin priviliges. you don't require admin rights to store screenshots to other partitions or others hard drives.)x";
-    cout<<"successfully created notes.txt..." <<endl;
-}
-
-
-void make_autoload_lua_file(string path_upto_username){
-        ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\scripts\\autoload.lua" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
-    }
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
 
-    file_writer<<R"x(-- This script automatically loads playlist entries before and after the
+// contents of scripts\autoload.lua
+constexpr char autoload_lua_source[] = R"x(-- This script automatically loads playlist entries before and after the
 -- the currently played file. It does so by scanning the directory a file is
 -- located in when starting playback. It sorts the directory entries
 -- alphabetically, and adds entries before and after the current file to
 -- the internal playlist. (It stops if it would add an already existing
 -- playlist entry at the same position - this makes it "stable".)
--- Add at most 5000 * 2 files when starting a file (before + after).
+-- Add at most 5000 * 2 files when starting a file (before + after), or
+-- window * 2 files at a time when the window option is set (see below).
 
 --[[
 To configure this script use file autoload.conf in directory script-opts (the "script-opts"
@@ -289,6 +381,12 @@ images=no
 videos=yes
 audio=yes
 ignore_hidden=yes
+native_index=yes
+window=10
+
+window is how many files are added on each side of the current one. More are
+added when playback gets within half a window of either end of the playlist.
+window=0 (the default) adds the whole folder (at most 5000 each side) at once.
 
 --]]
 
@@ -303,7 +401,9 @@ o = {
     images = true,
     videos = true,
     audio = true,
-    ignore_hidden = true
+    ignore_hidden = true,
+    native_index = true,
+    window = 0
 }
 options.read_options(o)
 
@@ -337,6 +437,74 @@ if o.videos then EXTENSIONS = SetUnion(EXTENSIONS, EXTENSIONS_VIDEO) end
 if o.audio then EXTENSIONS = SetUnion(EXTENSIONS, EXTENSIONS_AUDIO) end
 if o.images then EXTENSIONS = SetUnion(EXTENSIONS, EXTENSIONS_IMAGES) end
 
+-- Folders are sorted by the mpv_config program the installer copies to
+-- ~~/bin. It writes the sorted file names of a folder to ~~/autoload-cache,
+-- and that index is used until the folder's modified time changes. Without
+-- the program (or with native_index=no) the folder is sorted here instead.
+INDEX_HEADER = "mpv_config index 1"
+INDEX_HELPER = package.config:sub(1, 1) == "\\" and "~~/bin/mpv_config.exe"
+               or "~~/bin/mpv_config"
+
+function cache_file(dir, extension)
+    -- named after a hash of the folder, the folder itself is in the file
+    local hash = 5381
+    for i = 1, #dir do
+        hash = (hash * 33 + dir:byte(i)) % 2147483647
+    end
+    return mp.command_native({"expand-path",
+        ("~~/autoload-cache/%08x-%d.%s"):format(hash, #dir, extension)})
+end
+
+function read_lines(path)
+    local f = io.open(path, "rb")
+    if f == nil then
+        return nil
+    end
+    local lines = {}
+    for line in f:lines() do
+        lines[#lines + 1] = line
+    end
+    f:close()
+    return lines
+end
+
+function read_native_index(dir, mtime)
+    local index = cache_file(dir, "index")
+    local lines = read_lines(index)
+    local function current(lines)
+        return lines ~= nil and lines[1] == INDEX_HEADER and
+               lines[2] == mtime and lines[3] == dir
+    end
+    if not current(lines) then
+        local helper = mp.command_native({"expand-path", INDEX_HELPER})
+        if utils.file_info(helper) == nil then
+            return nil
+        end
+        local result = mp.command_native({
+            name = "subprocess",
+            args = {helper, "--index-dir", dir, index, mtime},
+            playback_only = false,
+            capture_stdout = true,
+            capture_stderr = true,
+        })
+        if result.status ~= 0 then
+            msg.verbose("native index failed: " ..
+                (result.stderr or result.error_string or ""))
+            return nil
+        end
+        lines = read_lines(index)
+        if not current(lines) then
+            return nil
+        end
+    end
+    local files = {}
+    for i = 4, #lines do
+        files[#files + 1] = lines[i]
+    end
+    msg.trace("using native index " .. index)
+    return files
+end
+
 function add_files_at(index, files)
     index = index - 1
     local oldcount = mp.get_property_number("playlist-count", 1)
@@ -346,6 +514,71 @@ function add_files_at(index, files)
     end
 end
 
+-- Add all files in one loadlist of a temporary playlist, then put them around
+-- entry pl_current (1-based) with playlist-move: either one per old entry that
+-- was after it plus one for the files before it, or one per new file, whichever
+-- is fewer. Falls back to add_files_at when the playlist can't be written.
+function add_files_around(pl_current, before, after)
+    if #before + #after == 0 then
+        return
+    end
+    local oldcount = mp.get_property_number("playlist-count", 1)
+    local cwd = mp.get_property("working-directory", "")
+    local lines = {"#EXTM3U"}
+    for _, files in ipairs({before, after}) do
+        for i = 1, #files do
+            if files[i]:find("[\r\n]") then
+                lines = nil
+                break
+            end
+            -- entries of a playlist file are relative to the playlist
+            lines[#lines + 1] = utils.join_path(cwd, files[i])
+        end
+        if lines == nil then
+            break
+        end
+    end
+
+    local list = mp.command_native({"expand-path",
+        "~~/autoload-cache/insert-" .. mp.get_property("pid", "0") .. ".m3u8"})
+    local f = lines and io.open(list, "wb")
+    if f then
+        f:write(table.concat(lines, "\n"), "\n")
+        f:close()
+        local loaded = mp.commandv("loadlist", list, "append")
+        os.remove(list)
+        if loaded and mp.get_property_number("playlist-count", 1) ==
+                oldcount + #before + #after then
+            -- now: old entries, before, after
+            local tail = oldcount - pl_current
+            if tail + (#before > 0 and 1 or 0) <= #before + #after then
+                for i = 1, tail do
+                    mp.commandv("playlist-move", pl_current, oldcount + #before + #after)
+                end
+                if #before > 0 then
+                    mp.commandv("playlist-move", pl_current - 1, pl_current + #before)
+                end
+            else
+                -- moving an entry back only shifts the ones in between, so
+                -- the new entries still waiting keep their index
+                for i = 1, #before do
+                    mp.commandv("playlist-move", oldcount + i - 1, pl_current + i - 2)
+                end
+                if tail > 0 then
+                    for i = 1, #after do
+                        mp.commandv("playlist-move", oldcount + #before + i - 1,
+                                    pl_current + #before + i - 1)
+                    end
+                end
+            end
+            return
+        end
+    end
+    msg.verbose("adding files one by one")
+    add_files_at(pl_current + 1, after)
+    add_files_at(pl_current, before)
+end
+
 function get_extension(path)
     match = string.match(path, "%.([^%.]+)$" )
     if match == nil then
@@ -355,12 +588,42 @@ function get_extension(path)
     end
 end
 
+-- Extensions the way they are written in file names: the ones in EXTENSIONS
+-- and their upper case, so most names need no string.lower. Other spellings
+-- (.Mkv) are looked up once and remembered, false for unknown extensions.
+EXTENSION_LOOKUP = {}
+for ext in pairs(EXTENSIONS) do
+    EXTENSION_LOOKUP[ext] = true
+    EXTENSION_LOOKUP[ext:upper()] = true
+end
+
+function has_extension(name)
+    local ext = string.match(name, "%.([^%.]+)$")
+    if ext == nil then
+        return false
+    end
+    local known = EXTENSION_LOOKUP[ext]
+    if known == nil then
+        known = EXTENSIONS[string.lower(ext)] or false
+        EXTENSION_LOOKUP[ext] = known
+    end
+    return known
+end
+
+-- keep the entries of t that iter returns true for, in order, moving each
+-- one at most once (table.remove would shift the rest of t every time)
 table.filter = function(t, iter)
-    for i = #t, 1, -1 do
-        if not iter(t[i]) then
-            table.remove(t, i)
+    local kept = 0
+    for i = 1, #t do
+        local v = t[i]
+        if iter(v) then
+            kept = kept + 1
+            t[kept] = v
         end
     end
+    for i = #t, kept + 1, -1 do
+        t[i] = nil
+    end
 end
 
 -- splitbynum and alnumcomp from alphanum.lua (C) Andre Bogus
@@ -382,9 +645,8 @@ function clean_key(k)
     return splitbynum(k)
 end
 
--- compare two strings
-function alnumcomp(x, y)
-    local xt, yt = clean_key(x), clean_key(y)
+-- compare two keys made by clean_key
+function keycomp(xt, yt)
     for i = 1, math.min(#xt, #yt) do
         local xe, ye = xt[i], yt[i]
         if type(xe) == "string" then ye = tostring(ye)
@@ -394,8 +656,220 @@ function alnumcomp(x, y)
     return #xt < #yt
 end
 
+-- compare two strings
+function alnumcomp(x, y)
+    return keycomp(clean_key(x), clean_key(y))
+end
+
+-- sort a list of file names like table.sort(files, alnumcomp), but make
+-- every key once up front instead of twice per comparison (file names in
+-- a folder are unique, so they can index the keys)
+function alnumsort(files)
+    local keys = {}
+    for i = 1, #files do
+        keys[files[i]] = clean_key(files[i])
+    end
+    table.sort(files, function (x, y) return keycomp(keys[x], keys[y]) end)
+end
+
+-- "script-message autoload-benchmark" times both sorts, and the filter, on
+-- made up folders
+function sort_benchmark()
+    math.randomseed(1)
+    local shows = {"Show Name", "another show", "Some  Movie", "track"}
+    for _, count in ipairs({1000, 5000, 50000}) do
+        local names = {}
+        for i = 1, count do
+            names[i] = ("%s - S%02dE%03d [%dp] v%d.%s"):format(
+                shows[math.random(#shows)], math.random(20), math.random(999),
+                math.random(2) == 1 and 720 or 1080, math.random(3),
+                math.random(2) == 1 and "mkv" or "MP4")
+        end
+        local copy = {}
+        for i = 1, count do copy[i] = names[i] end
+        local started = os.clock()
+        table.sort(names, alnumcomp)
+        local compared = os.clock() - started
+        started = os.clock()
+        alnumsort(copy)
+        local precomputed = os.clock() - started
+        msg.info(("%d files: alnumcomp %.3f s, precomputed keys %.3f s"):format(
+            count, compared, precomputed))
+    end
+end
+
+-- The filtered and sorted list of every folder is kept in ~~/autoload-cache
+-- as well, one small file per folder, keyed by the folder, its modified time
+-- and the options that change the filter. A folder that didn't change since
+-- the last time skips readdir, filtering and sorting entirely.
+LIST_HEADER = "autoload list 1"
+
+function list_key(mtime)
+    return ("%s %s%s%s%s"):format(tostring(mtime), o.videos and "v" or "-",
+        o.audio and "a" or "-", o.images and "i" or "-",
+        o.ignore_hidden and "h" or "-")
+end
+
+function read_cached_list(dir, key)
+    local lines = read_lines(cache_file(dir, "list"))
+    if lines == nil or lines[1] ~= LIST_HEADER or lines[2] ~= key or
+       lines[3] ~= dir then
+        return nil
+    end
+    local files = {}
+    for i = 4, #lines do
+        files[#files + 1] = lines[i]
+    end
+    return files
+end
+
+function write_cached_list(dir, key, files)
+    for i = 1, #files do
+        if files[i]:find("[\r\n]") then
+            return
+        end
+    end
+    local list = cache_file(dir, "list")
+    local f = io.open(list .. ".tmp", "wb")
+    if f == nil then
+        return
+    end
+    f:write(LIST_HEADER, "\n", key, "\n", dir, "\n")
+    if #files > 0 then
+        f:write(table.concat(files, "\n"), "\n")
+    end
+    f:close()
+    os.remove(list)  -- os.rename doesn't replace files on windows
+    os.rename(list .. ".tmp", list)
+end
+
+function list_folder(dir, filename)
+    local info = utils.file_info(dir)
+    -- a folder changed in the last second could change again without a new
+    -- mtime, so it isn't cached. neither is the list of a hidden current file,
+    -- the filter lets it through just for itself
+    local settled = info ~= nil and info.mtime < os.time() - 1
+    local cacheable = settled and
+        not (o.ignore_hidden and string.match(filename, "^%."))
+    local key = cacheable and list_key(info.mtime)
+    local files = key and read_cached_list(dir, key)
+    if files then
+        msg.trace("using cached list of " .. dir)
+        return files
+    end
+
+    files = nil
+    if settled and o.native_index then
+        files = read_native_index(dir, tostring(info.mtime))
+    end
+    local sorted = files ~= nil
+    if not sorted then
+        files = utils.readdir(dir, "files")
+        if files == nil then
+            msg.verbose("no other files in directory")
+            return nil
+        end
+    end
+    table.filter(files, function (v)
+        -- The current file could be a hidden file, ignoring it doesn't load other
+        -- files from the current directory.
+        if (o.ignore_hidden and not (v == filename) and string.byte(v) == 46) then -- "."
+            return false
+        end
+        return has_extension(v)
+    end)
+    if not sorted then
+        alnumsort(files)
+    end
+
+    if key then
+        write_cached_list(dir, key, files)
+    end
+    return files
+end
+
+-- the filter as it was (get_extension, string.lower and table.remove for
+-- every entry) against table.filter, on folders of growing size. time per
+-- entry staying flat is what linear looks like
+function filter_benchmark()
+    local extensions = {"mkv", "MP4", "srt", "nfo", "jpg", "Mkv", "txt"}
+    for _, count in ipairs({12500, 25000, 50000}) do
+        local names = {}
+        for i = 1, count do
+            names[i] = ("%sfile %d.%s"):format(i % 50 == 0 and "." or "", i,
+                extensions[i % #extensions + 1])
+        end
+        local copy = {}
+        for i = 1, count do copy[i] = names[i] end
+        local started = os.clock()
+        for i = #names, 1, -1 do
+            local v = names[i]
+            if string.match(v, "^%.") or
+               not EXTENSIONS[string.lower(get_extension(v))] then
+                table.remove(names, i)
+            end
+        end
+        local removing = os.clock() - started
+        started = os.clock()
+        table.filter(copy, function (v)
+            return string.byte(v) ~= 46 and has_extension(v)
+        end)
+        local compacting = os.clock() - started
+        msg.info(("%d files: table.remove %.3f s (%.2f us/file), " ..
+            "compaction %.3f s (%.2f us/file), %d kept"):format(count, removing,
+            removing / count * 1e6, compacting, compacting / count * 1e6, #copy))
+    end
+end
+
 local autoloaded = nil
 
+-- with o.window, what part of which folder the playlist holds: entries
+-- files[first] .. files[last] of dir, and nothing else
+local window = nil
+
+-- playlist entries added by add_files_around are absolute paths
+function same_file(entry, path)
+    return entry == path or
+        entry == utils.join_path(mp.get_property("working-directory", ""), path)
+end
+
+function extend_window()
+    local w = window
+    local pos = mp.get_property_number("playlist-pos-1", 0)
+    if w == nil or pos < 1 then
+        return
+    end
+    local count = mp.get_property_number("playlist-count", 0)
+    if not same_file(mp.get_property("playlist/0/filename", ""),
+                     w.dir .. w.files[w.first]) or
+       not same_file(mp.get_property(("playlist/%d/filename"):format(count - 1), ""),
+                     w.dir .. w.files[w.last]) then
+        msg.verbose("playlist was changed, not extending the window")
+        window = nil
+        return
+    end
+
+    local margin = math.max(1, math.floor(o.window / 2))
+    if count - pos <= margin and w.last < #w.files then
+        local after = {}
+        for i = w.last + 1, math.min(#w.files, w.last + o.window) do
+            after[#after + 1] = w.dir .. w.files[i]
+        end
+        msg.verbose(("adding %d more files"):format(#after))
+        w.last = w.last + #after
+        add_files_around(count, {}, after)
+    end
+    if pos - 1 <= margin and w.first > 1 then
+        local before = {}
+        for i = math.max(1, w.first - o.window), w.first - 1 do
+            before[#before + 1] = w.dir .. w.files[i]
+        end
+        msg.verbose(("prepending %d more files"):format(#before))
+        w.first = w.first - #before
+        add_files_around(1, before, {})
+    end
+end
+
 function find_and_add_entries()
     local path = mp.get_property("path", "")
     local dir, filename = utils.split_path(path)
@@ -411,7 +885,7 @@ function find_and_add_entries()
     local pl_count = mp.get_property_number("playlist-count", 1)
     -- check if this is a manually made playlist
     if (pl_count > 1 and autoloaded == nil) or
-       (pl_count == 1 and EXTENSIONS[string.lower(get_extension(filename))] == nil) then
+       (pl_count == 1 and not has_extension(filename)) then
         msg.verbose("stopping: manually made playlist")
         return
     else
@@ -423,24 +897,17 @@ function find_and_add_entries()
     msg.trace(("playlist-pos-1: %s, playlist: %s"):format(pl_current,
         utils.to_string(pl)))
 
-    local files = utils.readdir(dir, "files")
+    if window ~= nil and pl_count > 1 and
+       window.dir == (dir == "." and "" or dir) then
+        -- still in the window's folder, extend_window adds what's missing
+        extend_window()
+        return
+    end
+
+    local files = list_folder(dir, filename)
     if files == nil then
-        msg.verbose("no other files in directory")
         return
     end
-    table.filter(files, function (v, k)
-        -- The current file could be a hidden file, ignoring it doesn't load other
-        -- files from the current directory.
-        if (o.ignore_hidden and not (v == filename) and string.match(v, "^%.")) then
-            return false
-        end
-        local ext = get_extension(v)
-        if ext == nil then
-            return false
-        end
-        return EXTENSIONS[string.lower(ext)]
-    end)
-    table.sort(files, alnumcomp)
 
     if dir == "." then
         dir = ""
@@ -459,9 +926,10 @@ function find_and_add_entries()
     end
     msg.trace("current file position in files: "..current)
 
+    local limit = o.window > 0 and o.window or MAXENTRIES
     local append = {[-1] = {}, [1] = {}}
     for direction = -1, 1, 2 do -- 2 iterations, with direction = -1 and +1
-        for i = 1, MAXENTRIES do
+        for i = 1, limit do
             local file = files[current + i * direction]
             local pl_e = pl[pl_current + i * direction]
             if file == nil or file[1] == "." then
@@ -480,7 +948,7 @@ function find_and_add_entries()
             if direction == -1 then
                 if pl_current == 1 then -- never add additional entries in the middle
                     msg.info("Prepending " .. file)
-                    table.insert(append[-1], 1, filepath)
+                    table.insert(append[-1], filepath)
                 end
             else
                 msg.info("Adding " .. file)
@@ -489,33 +957,39 @@ function find_and_add_entries()
         end
     end
 
-    add_files_at(pl_current + 1, append[1])
-    add_files_at(pl_current, append[-1])
-end
-
-mp.register_event("start-file", find_and_add_entries))x";
-    cout<<"successfully created autoload.lua... "<<endl;
-}
+    -- files before the current one were found walking backwards
+    local before = {}
+    for i = #append[-1], 1, -1 do
+        before[#before + 1] = append[-1][i]
+    end
+    add_files_around(pl_current, before, append[1])
 
+    if o.window > 0 and pl_count == 1 then
+        -- the playlist is now exactly this part of the folder
+        window = {dir = dir, files = files, first = current - #before,
+                  last = current + #append[1]}
+    end
+end
 
-void make_mpv_chapters_js_file(string path_upto_username){
-        ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\scripts\\mpv_chapters.js" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
-    }
+mp.register_event("start-file", find_and_add_entries)
+mp.observe_property("playlist-pos", "number", extend_window)
+mp.register_script_message("autoload-benchmark", function ()
+    sort_benchmark()
+    filter_benchmark()
+end))x";
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
 
-    file_writer<<R"x("use strict";
+// contents of scripts\mpv_chapters.js
+constexpr char mpv_chapters_js_source[] = R"x("use strict";
 
 //display chapter on osd and easily switch between chapters by click on title of chapter
-mp.register_event("file-loaded", init);
+//the whole chapter list comes in one piece, when a file is loaded and whenever it changes
+mp.observe_property("chapter-list", "native", onChapterListChange);
 mp.observe_property("chapter", "number", onChapterChange);
-mp.observe_property("chapter-list/count", "number", init);
+mp.observe_property("osd-height", "number", onOsdResize);
 var options = {
-	font_size: 40,
+	font_size: 40, //largest size, smaller when the chapters don't fit
+	min_font_size: 14, //smallest size in screen pixels. below that the list is split into pages (mouse wheel to turn them)
 	font_color: "FFFFFF",
 	border_size: 1.0,
 	border_color: "000000",
@@ -526,95 +1000,193 @@ var playinfo = {
 	chaptercount: "", // int
 	assinterface: [], //array(deprecated, use single assdraw instead)
 	currentChapter: "", //int
+	lines: [], //rendered ass line of every chapter
+	lineStyle: "", //tags every line starts with
+	highlighted: -1, //line drawn in font_color_currentChapter
+	fontSize: 40, //font_size fitted to the chapter count and the osd
+	rowsPerPage: 1,
+	pageStart: 0, //first and one past the last chapter shown
+	pageEnd: 0,
+	titleWidths: [], //width of every title in em, measured the first time it is drawn
+	lineRight: [], //right edge of every drawn line in overlay units, what clicks are tested against
     loaded:false,
 };
+var listHeight = 1000 / 1.5; //in overlay units, the overlay is 720 high whatever the window size
 var toggle_switch = false;
 var assdraw = mp.create_osd_overlay("ass-events");
 var autohidedelay = mp.get_property_number("cursor-autohide");
 //function
-function init() {
-	playinfo.chapters = getChapters();
+function init(chapters) {
+	playinfo.chapters = chapters;
 	playinfo.chaptercount = playinfo.chapters.length;
+	playinfo.titleWidths = [];
     if(playinfo.chaptercount == 0){
         return;
     }
-	while (playinfo.chaptercount * options.font_size > 1000 / 1.5) {
-		options.font_size = options.font_size - 1;
-	}
+	layoutChapters();
+	playinfo.currentChapter = mp.get_property_native("chapter"); //the list can load after playback started (resume, chapter-list changing mid-file)
+	playinfo.pageStart = pageOf(playinfo.currentChapter);
 	drawChapterList();
 	mp.msg.info("initiated");
     playinfo.loaded = true;
 }
-function getChapters() {
-	var chapterCount = mp.get_property("chapter-list/count");
-	if (chapterCount === 0) {
-		return ["null"];
-	} else {
-		var chaptersArray = [];
-		for (var index = 0; index < chapterCount; index++) {
-			var chapterTitle = mp.get_property_native(
-				"chapter-list/" + index + "/title"
-			);
-
-			if (chapterTitle != undefined) {
-				chaptersArray.push(chapterTitle);
-			}
+function getChapters(chapterList) {
+	var chaptersArray = [];
+	(chapterList || []).forEach(function (chapter) {
+		if (chapter.title != undefined) {
+			chaptersArray.push(chapter.title);
 		}
-		return chaptersArray;
+	});
+	return chaptersArray;
+}
+function onChapterListChange(name, chapterList) {
+	var chapters = getChapters(chapterList);
+	if (playinfo.loaded && chapters.join("\n") == playinfo.chapters.join("\n")) {
+		return; //same titles (another file of the same disc...), keep what is drawn
 	}
+	init(chapters);
 }
 
-function drawChapterList() {
-	var resY = 0;
-	var resX = 0;
-	var assdrawdata = "";
-	function setPos(str, _X, _Y) {
-		str = str + "{\\pos(" + _X + ", " + _Y + ")}";
-		return str;
+//largest size up to font_size that fits every chapter, but never under the legibility floor:
+//then the list shows rowsPerPage chapters at a time. options.font_size itself is never changed
+function layoutChapters() {
+	var osd = mp.get_osd_size();
+	var osdHeight = (osd && osd.height) || 720;
+	var floorSize = Math.ceil((options.min_font_size * 720) / osdHeight);
+	var fitSize = Math.floor(listHeight / Math.max(1, playinfo.chaptercount));
+	playinfo.fontSize = Math.max(Math.min(options.font_size, fitSize), floorSize);
+	playinfo.rowsPerPage = Math.max(1, Math.floor(listHeight / playinfo.fontSize));
+}
+function pageOf(index) {
+	return Math.floor(Math.max(0, index || 0) / playinfo.rowsPerPage) * playinfo.rowsPerPage; //no chapter yet (undefined, -1) is the first page
+}
+function onOsdResize() {
+	if (!playinfo.loaded) {
+		return;
+	}
+	layoutChapters();
+	playinfo.pageStart = pageOf(playinfo.currentChapter);
+	drawChapterList();
+	if (toggle_switch) {
+		assdraw.update();
+	}
+}
+function scrollPage(direction) {
+	var start = playinfo.pageStart + direction * playinfo.rowsPerPage;
+	if (start < 0 || start >= playinfo.chaptercount) {
+		return;
 	}
-	function setborderSize(str) {
-		str = str + "{\\bord" + options.border_size + "}";
-		return str;
+	playinfo.pageStart = start;
+	drawChapterList();
+	assdraw.update();
+}
+
+//titles are measured by rendering them on a hidden overlay: since mpv 0.34 update() returns the box
+//of what it rendered. the overlay has the same 720 high coordinates as assdraw
+var measureOverlay = mp.create_osd_overlay("ass-events");
+measureOverlay.compute_bounds = true;
+measureOverlay.hidden = true;
+var boundsSupported = true;
+function measureTitle(title) {
+	if (boundsSupported) {
+		measureOverlay.data = "{\\pos(0, 0)}{\\bord0}{\\fs100}{\\p0}" + title;
+		var box = measureOverlay.update();
+		if (box && box.x1 !== undefined && box.x1 > box.x0) {
+			return box.x1 / 100;
+		}
+		if (/\S/.test(title)) {
+			boundsSupported = false; //older mpv returns no box at all, estimate from now on
+		}
 	}
-	function setborderColor(str) {
-		str = str + "{\\3c&H" + options.border_color + "&}";
-		return str;
+	return titleWidth(title);
+}
+
+//fallback for mpv before 0.34: advance of every printable ascii character in em, close to the default sans-serif osd font
+var asciiAdvance = (function () {
+	var advance = [];
+	for (var code = 32; code < 127; code++) {
+		var c = String.fromCharCode(code);
+		if ("ijl|!.,:;'`".indexOf(c) >= 0) advance[code] = 0.28;
+		else if (" frtI()[]{}-\"/\\".indexOf(c) >= 0) advance[code] = 0.36;
+		else if ("mwMW@%".indexOf(c) >= 0) advance[code] = 0.9;
+		else if (c >= "A" && c <= "Z") advance[code] = 0.68;
+		else if (c >= "0" && c <= "9") advance[code] = 0.56;
+		else advance[code] = 0.55;
 	}
-	function setFontColor(str, index) {
-		var _color;
-		if (playinfo.currentChapter == index) {
-			_color = options.font_color_currentChapter;
+	return advance;
+})();
+function isWide(code) {
+	//cjk, hangul, fullwidth forms: a whole em
+	return (code >= 0x1100 && code <= 0x115f) || (code >= 0x2e80 && code <= 0xa4cf) ||
+		(code >= 0xac00 && code <= 0xd7a3) || (code >= 0xf900 && code <= 0xfaff) ||
+		(code >= 0xfe30 && code <= 0xfe4f) || (code >= 0xff00 && code <= 0xff60) ||
+		(code >= 0xffe0 && code <= 0xffe6);
+}
+function titleWidth(title) {
+	var width = 0;
+	for (var i = 0; i < title.length; i++) {
+		var code = title.charCodeAt(i);
+		if (code >= 0xd800 && code <= 0xdbff) {
+			width += 1; //characters outside the bmp (emoji, rare cjk) come in two halves
+			i++;
+		} else if (asciiAdvance[code] !== undefined) {
+			width += asciiAdvance[code];
 		} else {
-			_color = options.font_color;
+			width += isWide(code) ? 1 : 0.6;
 		}
-		str = str + "{\\c&H" + _color + "&}";
-		return str;
 	}
-	function setFont(str) {
-		str = str + "{\\fs" + options.font_size + "}";
-		return str;
+	return width;
+}
+
+//the overlay is one line per chapter, kept in playinfo.lines so a chapter change
+//only renders the line that loses the highlight and the one that gets it
+function renderLine(index) {
+	var color = options.font_color;
+	if (playinfo.currentChapter == index) {
+		color = options.font_color_currentChapter;
+		playinfo.highlighted = index;
+	}
+	playinfo.lines[index] =
+		"{\\pos(0, " + (index - playinfo.pageStart) * playinfo.fontSize + ")}" +
+		playinfo.lineStyle +
+		"{\\c&H" + color + "&}{\\fs" + playinfo.fontSize + "}{\\p0}" +
+		playinfo.chapters[index] + "\n";
+	if (playinfo.titleWidths[index] === undefined) {
+		playinfo.titleWidths[index] = measureTitle(playinfo.chapters[index]);
+	}
+	playinfo.lineRight[index] = playinfo.titleWidths[index] * playinfo.fontSize + 2 * options.border_size;
+}
+
+function drawChapterList() {
+	//border size and color are the same on every line
+	playinfo.lineStyle =
+		"{\\bord" + options.border_size + "}{\\3c&H" + options.border_color + "&}";
+	playinfo.lines = [];
+	playinfo.lineRight = [];
+	playinfo.highlighted = -1;
+	playinfo.pageEnd = Math.min(playinfo.chaptercount, playinfo.pageStart + playinfo.rowsPerPage);
+	for (var index = playinfo.pageStart; index < playinfo.pageEnd; index++) {
+		renderLine(index);
+	}
+	assdraw.data = playinfo.lines.slice(playinfo.pageStart, playinfo.pageEnd).join("");
+}
+
+function redrawCurrentChapter() {
+	var current = playinfo.currentChapter;
+	if (current >= 0 && (current < playinfo.pageStart || current >= playinfo.pageEnd)) {
+		playinfo.pageStart = pageOf(current); //follow the current chapter to its page
+		drawChapterList();
+		return;
 	}
-	function setEndofmodifiers(str) {
-		str = str + "{\\p0}";
-		return str;
+	var previous = playinfo.highlighted;
+	playinfo.highlighted = -1;
+	if (previous >= 0) {
+		renderLine(previous);
 	}
-	function setEndofLine(str) {
-		str = str + "\n";
-		return str;
+	if (current >= 0 && current < playinfo.chaptercount) {
+		renderLine(current);
 	}
-	playinfo.chapters.forEach(function (element, index) {
-		assdrawdata = setPos(assdrawdata, resX, resY);
-		assdrawdata = setborderSize(assdrawdata);
-		assdrawdata = setborderColor(assdrawdata);
-		assdrawdata = setFontColor(assdrawdata, index);
-		assdrawdata = setFont(assdrawdata);
-		assdrawdata = setEndofmodifiers(assdrawdata);
-		assdrawdata = assdrawdata + element;
-		assdrawdata = setEndofLine(assdrawdata);
-		resY += options.font_size;
-	});
-	assdraw.data = assdrawdata
-	
+	assdraw.data = playinfo.lines.slice(playinfo.pageStart, playinfo.pageEnd).join("");
 }
 
 function toggleOverlay() {
@@ -622,13 +1194,18 @@ function toggleOverlay() {
         return;
     }
 	if (!toggle_switch) {
-		drawChapterList();
-		assdraw.update();
+		assdraw.update(); //the lines are kept up to date while hidden
 		mp.set_property("cursor-autohide", "no");
+		if (playinfo.rowsPerPage < playinfo.chaptercount) {
+			mp.add_forced_key_binding("WHEEL_UP", "page_up", function () { scrollPage(-1); });
+			mp.add_forced_key_binding("WHEEL_DOWN", "page_down", function () { scrollPage(1); });
+		}
 		toggle_switch = !toggle_switch;
 	} else {
 		assdraw.remove();
 		mp.set_property("cursor-autohide", autohidedelay);
+		mp.remove_key_binding("page_up");
+		mp.remove_key_binding("page_down");
 		toggle_switch = !toggle_switch;
 	}
 }
@@ -636,24 +1213,25 @@ function toggleOverlay() {
 function onChapterChange() {
 	playinfo.currentChapter = mp.get_property_native("chapter");
 	if (playinfo.currentChapter != undefined) {
-		drawChapterList();
+		redrawCurrentChapter();
 	}
 
 	if ((playinfo.currentChapter != undefined) & toggle_switch) {
 		assdraw.update();
 	}
 }
+//every line is fontSize high from the top of the overlay, so the row is a division
+//and the title is hit if x is left of the line's measured right edge
 function pos2chapter(x, y, overallscale) {
-	var vectical = y / (options.font_size * overallscale);
-    if(vectical > playinfo.chaptercount){
-        return null;
-    }
-	var intVectical = Math.floor(vectical);
-	var lengthofTitleClicked = playinfo.chapters[intVectical].length;
-	var lengthofTitleClicked_px =
-		(lengthofTitleClicked * options.font_size) / overallscale;
-	if (x < lengthofTitleClicked_px) {
-		return intVectical;
+	var row = Math.floor(y / overallscale / playinfo.fontSize);
+	if (row < 0 || row >= playinfo.pageEnd - playinfo.pageStart) {
+		return null;
+	}
+	var index = playinfo.pageStart + row;
+	var right = playinfo.lineRight[index];
+	var overlayX = x / overallscale;
+	if (right !== undefined && overlayX >= 0 && overlayX <= right) {
+		return index;
 	} else {
 		return null;
 	}
@@ -682,21 +1260,10 @@ mp.add_key_binding("MBTN_LEFT", "mbtn_left", function () {
 	onMBTN_LEFT();
 });
 )x";
-    cout<<"successfully created mpv_chapters.js... "<<endl<<endl;
-}
-
-
-void make_webm_lua_file(string path_upto_username){
-        ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\scripts\\webm.lua" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
-    }
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
 
-    file_writer<<R"x(local mp = require("mp")
+// contents of scripts\webm.lua
+constexpr char webm_lua_source[] = R"x(local mp = require("mp")
 local assdraw = require("mp.assdraw")
 local msg = require("mp.msg")
 local utils = require("mp.utils")
@@ -763,6 +1330,19 @@ local options = {
 	write_filename_on_metadata = false,
 	-- Set the number of encoding threads, for codecs libvpx and libvpx-vp9
 	threads = 4,
+	-- Cut long clips into this many pieces at keyframes, encode the pieces at
+	-- the same time and join them without re-encoding. The audio is encoded
+	-- once for the whole clip, so the joins have no gaps. Needs ffprobe and
+	-- ffmpeg in PATH, and doesn't apply to GIF, streams or run_detached. 1
+	-- encodes the clip in one piece.
+	parallel_segments = 1,
+	-- Pieces are never shorter than this, in seconds.
+	segment_min_length = 30,
+	-- How many pieces are encoded at the same time. Each one also uses "threads"
+	-- threads, so keep this times threads around the number of cores.
+	segment_workers = 2,
+	-- How many encodes from the queue (a in the menu) run at the same time.
+	max_jobs = 2,
 	additional_flags = "",
 	-- Constant Rate Factor (CRF). The value meaning and limits may change,
 	-- from codec to codec. Set to -1 to disable.
@@ -771,7 +1351,7 @@ local options = {
 	-- Won't be applied when strict_filesize_constraint is on.
 	non_strict_additional_flags = "",
 	-- Display the encode progress, in %. Requires run_detached to be disabled.
-	-- On Windows, it shows a cmd popup. "auto" will display progress on non-Windows platforms.
+	-- "auto" displays it on every platform.
 	display_progress = "auto",
 	-- The font size used in the menu. Isn't used for the notifications (started encode, finished encode etc)
 	font_size = 28,
@@ -787,8 +1367,78 @@ local options = {
 mpopts.read_options(options)
 local base64_chars='ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/'
 
--- encoding
+-- lookup tables: every 12 bit value to its two base64 characters, and every
+-- base64 character back to its 6 bit value
+local base64_pairs = {}
+for i = 0, 4095 do
+    local hi, lo = math.floor(i / 64) + 1, i % 64 + 1
+    base64_pairs[i] = base64_chars:sub(hi, hi) .. base64_chars:sub(lo, lo)
+end
+local base64_values = {}
+for i = 1, 64 do
+    base64_values[base64_chars:byte(i)] = i - 1
+end
+
+-- encoding: 3 bytes at a time into two table entries, joined once at the end
 function base64_encode(data)
+    local out, n = {}, 0
+    local full = #data - #data % 3
+    for i = 1, full, 3 do
+        local a, b, c = data:byte(i, i + 2)
+        local v = a * 65536 + b * 256 + c
+        out[n + 1] = base64_pairs[math.floor(v / 4096)]
+        out[n + 2] = base64_pairs[v % 4096]
+        n = n + 2
+    end
+    local rest = #data - full
+    if rest > 0 then
+        local a, b = data:byte(full + 1, full + 2)
+        local v = a * 65536 + (b or 0) * 256
+        local tail = base64_pairs[math.floor(v / 4096)] .. base64_pairs[v % 4096]
+        out[n + 1] = tail:sub(1, rest + 1) .. (rest == 1 and '==' or '=')
+    end
+    return table.concat(out)
+end
+
+-- decoding: 4 characters at a time into 3 bytes, turned into a string a few
+-- thousand bytes at a time
+function base64_decode(data)
+    if data:find('[^%w+/]') then  -- %w is just A-Z, a-z and 0-9 in the C locale mpv runs in
+        data = data:gsub('[^%w+/]', '')
+    end
+    local out, bytes, n = {}, {}, 0
+    local full = #data - #data % 4
+    for i = 1, full, 4 do
+        local a, b, c, d = data:byte(i, i + 3)
+        local v = base64_values[a] * 262144 + base64_values[b] * 4096 +
+                  base64_values[c] * 64 + base64_values[d]
+        bytes[n + 1] = math.floor(v / 65536)
+        bytes[n + 2] = math.floor(v / 256) % 256
+        bytes[n + 3] = v % 256
+        n = n + 3
+        if n >= 3000 then
+            out[#out + 1] = string.char(unpack(bytes, 1, n))
+            n = 0
+        end
+    end
+    local rest = #data - full  -- 2 or 3 characters left when there was padding
+    if rest >= 2 then
+        local a, b, c = data:byte(full + 1, full + 3)
+        local v = base64_values[a] * 262144 + base64_values[b] * 4096 +
+                  (c and base64_values[c] * 64 or 0)
+        bytes[n + 1] = math.floor(v / 65536)
+        n = n + 1
+        if rest == 3 then
+            bytes[n + 1] = math.floor(v / 256) % 256
+            n = n + 1
+        end
+    end
+    out[#out + 1] = string.char(unpack(bytes, 1, n))
+    return table.concat(out)
+end
+
+-- the first versions, one string of '0' and '1' per byte. only kept for the benchmark
+function base64_encode_bits(data)
     return ((data:gsub('.', function(x) 
         local r,b='',x:byte()
         for i=8,1,-1 do r=r..(b%2^i-b%2^(i-1)>0 and '1' or '0') end
@@ -801,8 +1451,7 @@ function base64_encode(data)
     end)..({ '', '==', '=' })[#data%3+1])
 end
 
--- decoding
-function base64_decode(data)
+function base64_decode_bits(data)
     data = string.gsub(data, '[^'..base64_chars..'=]', '')
     return (data:gsub('.', function(x)
         if (x == '=') then return '' end
@@ -816,6 +1465,41 @@ function base64_decode(data)
         return string.char(c)
     end))
 end
+
+-- "script-message mpv-webm-benchmark": throughput of both base64 versions on
+-- random data the size of a long first pass log
+local benchmarks = {}
+benchmarks[#benchmarks + 1] = function()
+  math.randomseed(1)
+  local size = 256 * 1024
+  local random_bytes = {}
+  for i = 1, size do
+    random_bytes[i] = math.random(0, 255)
+  end
+  local parts = {}
+  for i = 1, size, 4096 do
+    parts[#parts + 1] = string.char(unpack(random_bytes, i, math.min(size, i + 4095)))
+  end
+  local data = table.concat(parts)
+  local megabytes = size / (1024 * 1024)
+  for _, codec in ipairs({{"bits", base64_encode_bits, base64_decode_bits}, {"table", base64_encode, base64_decode}}) do
+    local started = os.clock()
+    local encoded = codec[2](data)
+    local encode_time = os.clock() - started
+    started = os.clock()
+    local decoded = codec[3](encoded)
+    local decode_time = os.clock() - started
+    msg.info(("base64 %s: encode %.2f MB/s, decode %.2f MB/s%s"):format(codec[1],
+      megabytes / encode_time, megabytes / decode_time, decoded == data and "" or " (ROUND TRIP FAILED)"))
+  end
+end
+local run_benchmarks
+run_benchmarks = function()
+  for _index_0 = 1, #benchmarks do
+    benchmarks[_index_0]()
+  end
+end
+mp.register_script_message("mpv-webm-benchmark", run_benchmarks)
 local emit_event
 emit_event = function(event_name, ...)
   return mp.commandv("script-message", "webm-" .. tostring(event_name), ...)
@@ -1012,7 +1696,6 @@ parse_directory = function(dir)
   dir, _ = dir:gsub("^~", home_dir)
   return dir
 end
-local is_windows = type(package) == "table" and type(package.config) == "string" and package.config:sub(1, 1) == "\\"
 local trim
 trim = function(s)
   return s:match("^%s*(.-)%s*$")
@@ -1024,44 +1707,6 @@ get_null_path = function()
   end
   return "NUL"
 end
-local run_subprocess
-run_subprocess = function(params)
-  local res = utils.subprocess(params)
-  msg.verbose("Command stdout: ")
-  msg.verbose(res.stdout)
-  if res.status ~= 0 then
-    msg.verbose("Command failed! Reason: ", res.error, " Killed by us? ", res.killed_by_us and "yes" or "no")
-    return false
-  end
-  return true
-end
-local shell_escape
-shell_escape = function(args)
-  local ret = { }
-  for i, a in ipairs(args) do
-    local s = tostring(a)
-    if string.match(s, "[^A-Za-z0-9_/:=-]") then
-      if is_windows then
-        s = '"' .. string.gsub(s, '"', '"\\""') .. '"'
-      else
-        s = "'" .. string.gsub(s, "'", "'\\''") .. "'"
-      end
-    end
-    table.insert(ret, s)
-  end
-  local concat = table.concat(ret, " ")
-  if is_windows then
-    concat = '"' .. concat .. '"'
-  end
-  return concat
-end
-local run_subprocess_popen
-run_subprocess_popen = function(command_line)
-  local command_line_string = shell_escape(command_line)
-  command_line_string = command_line_string .. " 2>&1"
-  msg.verbose("run_subprocess_popen: running " .. tostring(command_line_string))
-  return io.popen(command_line_string)
-end
 local calculate_scale_factor
 calculate_scale_factor = function()
   local baseResY = 720
@@ -1071,7 +1716,7 @@ end
 local should_display_progress
 should_display_progress = function()
   if options.display_progress == "auto" then
-    return not is_windows
+    return true
   end
   return options.display_progress
 end
@@ -1370,6 +2015,7 @@ local FirstpassStats
 do
   local _class_0
   local duration_multiplier, fields_before_duration, fields_after_duration
+  local record_bytes = { }
   local _base_0 = {
     get_duration = function(self)
       local big_endian_binary_duration = reverse(self.binary_duration)
@@ -1379,14 +2025,21 @@ do
       local big_endian_binary_duration = write_double(duration * duration_multiplier)
       self.binary_duration = reverse(big_endian_binary_duration)
     end,
-    _bytes_to_string = function(self, bytes)
-      return string.char(unpack(bytes))
-    end,
     as_binary_string = function(self)
-      local before_duration_string = self:_bytes_to_string(self.binary_data_before_duration)
-      local duration_string = self:_bytes_to_string(self.binary_duration)
-      local after_duration_string = self:_bytes_to_string(self.binary_data_after_duration)
-      return before_duration_string .. duration_string .. after_duration_string
+      local n = 0
+      local _list_0 = {
+        self.binary_data_before_duration,
+        self.binary_duration,
+        self.binary_data_after_duration
+      }
+      for _index_0 = 1, #_list_0 do
+        local bytes = _list_0[_index_0]
+        for _index_1 = 1, #bytes do
+          n = n + 1
+          record_bytes[n] = bytes[_index_1]
+        end
+      end
+      return string.char(unpack(record_bytes, 1, n))
     end
   }
   _base_0.__index = _base_0
@@ -1480,23 +2133,85 @@ end
 local write_stats_array_to_logfile
 write_stats_array_to_logfile = function(stats_array, logfile_path)
   local file = assert(io.open(logfile_path, "wb"))
-  local logfile_string = ""
+  local records = { }
   for _index_0 = 1, #stats_array do
     local stat = stats_array[_index_0]
-    logfile_string = logfile_string .. stat:as_binary_string()
+    records[_index_0] = stat:as_binary_string()
   end
-  file:write(base64_encode(logfile_string))
+  file:write(base64_encode(table.concat(records)))
   return file:close()
 end
-local vp8_patch_logfile
-vp8_patch_logfile = function(logfile_path, encode_total_duration)
-  local stats_array = read_logfile_into_stats_array(logfile_path)
-  local average_duration = encode_total_duration / (#stats_array - 1)
-  for i = 1, #stats_array - 1 do
-    stats_array[i]:set_duration(average_duration)
+benchmarks[#benchmarks + 1] = function()
+  local bytes = { }
+  for i = 1, FirstpassStats:size() do
+    bytes[i] = i % 256
   end
-  stats_array[#stats_array]:set_duration(encode_total_duration)
-  return write_stats_array_to_logfile(stats_array, logfile_path)
+  local stat = FirstpassStats:from_bytes(bytes)
+  local logfile_path = mp.command_native({
+    "expand-path",
+    "~~/webm-benchmark-pass1.log"
+  })
+  local time_write
+  time_write = function(frames, write)
+    local stats_array = { }
+    for i = 1, frames do
+      stats_array[i] = stat
+    end
+    local started = os.clock()
+    write(stats_array, logfile_path)
+    return os.clock() - started
+  end
+  local write_by_appending
+  write_by_appending = function(stats_array, path)
+    local file = assert(io.open(path, "wb"))
+    local logfile_string = ""
+    for _index_0 = 1, #stats_array do
+      logfile_string = logfile_string .. stats_array[_index_0]:as_binary_string()
+    end
+    file:write(base64_encode(logfile_string))
+    return file:close()
+  end
+  for _, frames in ipairs({2000, 4000, 8000}) do
+    local seconds = time_write(frames, write_by_appending)
+    msg.info(("log of %d frames, appending: %.3f s (%.2f us/frame)"):format(frames, seconds, seconds / frames * 1e6))
+  end
+  for _, frames in ipairs({62500, 125000, 250000, 500000}) do
+    local seconds = time_write(frames, write_stats_array_to_logfile)
+    msg.info(("log of %d frames, one concat: %.3f s (%.2f us/frame)"):format(frames, seconds, seconds / frames * 1e6))
+  end
+  return os.remove(logfile_path)
+end
+-- the installer copies itself to ~~/bin, and can patch the log in place in a few
+-- milliseconds (mpv_config --patch-vp8-log). the lua version is the fallback
+local native_helper = package.config:sub(1, 1) == "\\" and "~~/bin/mpv_config.exe" or "~~/bin/mpv_config"
+local vp8_patch_logfile
+vp8_patch_logfile = function(logfile_path, encode_total_duration)
+  local helper = mp.command_native({
+    "expand-path",
+    native_helper
+  })
+  if utils.file_info(helper) then
+    local res = utils.subprocess({
+      args = {
+        helper,
+        "--patch-vp8-log",
+        logfile_path,
+        tostring(encode_total_duration)
+      },
+      cancellable = false
+    })
+    if res.status == 0 then
+      return 
+    end
+    msg.verbose("Native log patcher failed, patching in lua instead")
+  end
+  local stats_array = read_logfile_into_stats_array(logfile_path)
+  local average_duration = encode_total_duration / (#stats_array - 1)
+  for i = 1, #stats_array - 1 do
+    stats_array[i]:set_duration(average_duration)
+  end
+  stats_array[#stats_array]:set_duration(encode_total_duration)
+  return write_stats_array_to_logfile(stats_array, logfile_path)
 end
 local formats = { }
 local Format
@@ -2190,6 +2905,17 @@ do
   _base_0.__class = _class_0
   Page = _class_0
 end
+local progress_script = [[
+local status = io.open(%q, "w")
+mp.add_periodic_timer(0.25, function()
+  local time = mp.get_property_number("time-pos")
+  if status and time then
+    status:seek("set")
+    status:write(string.format("Encode time-pos: %%.3f\n", time))
+    status:flush()
+  end
+end)
+]]
 local EncodeWithProgress
 do
   local _class_0
@@ -2219,34 +2945,57 @@ do
         self.finishedReason = matchExit
       end
     end,
-    startEncode = function(self, command_line)
-      local copy_command_line
-      do
-        local _accum_0 = { }
-        local _len_0 = 1
-        for _index_0 = 1, #command_line do
-          local arg = command_line[_index_0]
-          _accum_0[_len_0] = arg
-          _len_0 = _len_0 + 1
-        end
-        copy_command_line = _accum_0
+    readProgress = function(self)
+      local status = io.open(self.statusPath, "r")
+      if not status then
+        return 
       end
-      append(copy_command_line, {
-        '--term-status-msg=Encode time-pos: ${=time-pos}\\n'
-      })
-      self:show()
-      local processFd = run_subprocess_popen(copy_command_line)
-      for line in processFd:lines() do
-        msg.verbose(string.format('%q', line))
+      local line = status:read("*l")
+      status:close()
+      if line then
         self:parseLine(line)
-        self:draw()
       end
-      processFd:close()
-      self:hide()
-      if self.finishedReason == "End of file" then
-        return true
+      local progress = math.floor(100 * ((self.currentTime - self.startTime) / self.duration))
+      if progress ~= self.drawnProgress then
+        self.drawnProgress = progress
+        return self:draw()
       end
-      return false
+    end,
+    startEncode = function(self, command_line, out_path, done)
+      self.statusPath = tostring(out_path) .. "-progress.txt"
+      self.scriptPath = tostring(out_path) .. "-progress.lua"
+      local script = io.open(self.scriptPath, "w")
+      if not script then
+        return done(false)
+      end
+      script:write(string.format(progress_script, self.statusPath))
+      script:close()
+      local copy_command_line = append(append({ }, command_line), {
+        "--script=" .. tostring(self.scriptPath)
+      })
+      self:show()
+      self.timer = mp.add_periodic_timer(0.25, function()
+        return self:readProgress()
+      end)
+      return mp.command_native_async({
+        name = "subprocess",
+        args = copy_command_line,
+        playback_only = false,
+        capture_stdout = true,
+        capture_stderr = true
+      }, function(success, result)
+        self.timer:kill()
+        os.remove(self.scriptPath)
+        os.remove(self.statusPath)
+        result = result or { }
+        local output = tostring(result.stdout or "") .. "\n" .. tostring(result.stderr or "")
+        for line in output:gmatch("[^\r\n]+") do
+          msg.verbose(string.format('%q', line))
+          self:parseLine(line)
+        end
+        self:hide()
+        return done(success and self.finishedReason == "End of file")
+      end)
     end
   }
   _base_0.__index = _base_0
@@ -2539,6 +3288,7 @@ calculate_bitrate = function(active_tracks, format, length)
   return video_bitrate, audio_bitrate
 end
 local find_path
+local cache_dumps = 0
 find_path = function(startTime, endTime)
   local path = mp.get_property('path')
   if not path then
@@ -2548,7 +3298,8 @@ find_path = function(startTime, endTime)
   local is_temporary = false
   if is_stream then
     if mp.get_property('file-format') == 'hls' then
-      path = utils.join_path(parse_directory('~'), 'cache_dump.ts')
+      cache_dumps = cache_dumps + 1
+      path = utils.join_path(parse_directory('~'), "cache_dump-" .. tostring(mp.get_property("pid", "0")) .. "-" .. tostring(cache_dumps) .. ".ts")
       mp.command_native({
         'dump_cache',
         seconds_to_time_string(startTime, false, true),
@@ -2562,8 +3313,334 @@ find_path = function(startTime, endTime)
   end
   return path, is_stream, is_temporary, startTime, endTime
 end
-local encode
-encode = function(region, startTime, endTime)
+local run_steps
+run_steps = function(steps, done, i)
+  i = i or 1
+  local step = steps[i]
+  if step == nil then
+    return done(true)
+  end
+  if type(step) == "function" then
+    local ok, err = pcall(step)
+    if not ok then
+      msg.warn(err)
+      return done(false)
+    end
+    return run_steps(steps, done, i + 1)
+  end
+  msg.verbose("Running:", table.concat(step, " "))
+  return mp.command_native_async({
+    name = "subprocess",
+    args = step,
+    playback_only = false,
+    capture_stdout = true,
+    capture_stderr = true
+  }, function(success, result)
+    if not success or result.status ~= 0 then
+      msg.warn("Command failed:", table.concat(step, " "))
+      return done(false)
+    end
+    return run_steps(steps, done, i + 1)
+  end)
+end
+local run_jobs_in_parallel
+run_jobs_in_parallel = function(jobs, limit, done)
+  local next_job, running, failed = 1, 0, false
+  local start_more
+  start_more = function()
+    while running < limit and next_job <= #jobs and not failed do
+      local job = jobs[next_job]
+      next_job = next_job + 1
+      running = running + 1
+      run_steps(job, function(ok)
+        running = running - 1
+        failed = failed or not ok
+        if running == 0 and (failed or next_job > #jobs) then
+          return done(not failed)
+        end
+        return start_more()
+      end)
+    end
+  end
+  return start_more()
+end
+local with_argument
+with_argument = function(command, prefix, value)
+  local result = { }
+  for _index_0 = 1, #command do
+    local arg = command[_index_0]
+    if arg:sub(1, #prefix) == prefix then
+      arg = prefix .. value
+    end
+    result[#result + 1] = arg
+  end
+  return result
+end
+local find_segment_points
+find_segment_points = function(path, startTime, endTime, count, done)
+  local probe
+  probe = function(args, callback)
+    return mp.command_native_async({
+      name = "subprocess",
+      args = append({
+        "ffprobe",
+        "-v",
+        "error"
+      }, args),
+      playback_only = false,
+      capture_stdout = true
+    }, function(success, result)
+      if not success or result == nil or result.status ~= 0 then
+        msg.verbose("ffprobe failed, encoding in one piece")
+        return done(nil)
+      end
+      return callback(result.stdout or "")
+    end)
+  end
+  return probe({
+    "-show_entries",
+    "format=start_time",
+    "-of",
+    "csv=p=0",
+    path
+  }, function(output)
+    local offset = tonumber(output:match("[-%d%.]+")) or 0
+    return probe({
+      "-select_streams",
+      "v:0",
+      "-read_intervals",
+      string.format("%f%%%f", startTime + offset, endTime + offset),
+      "-show_entries",
+      "packet=pts_time,flags",
+      "-of",
+      "csv=p=0",
+      path
+    }, function(output)
+      local keyframes = { }
+      for time, flags in output:gmatch("([-%d%.]+),([^\r\n]*)") do
+        if flags:find("K") then
+          keyframes[#keyframes + 1] = tonumber(time) - offset
+        end
+      end
+      table.sort(keyframes)
+      local points = {
+        startTime
+      }
+      local k = 1
+      for i = 1, count - 1 do
+        local ideal = startTime + i * (endTime - startTime) / count
+        while keyframes[k] and keyframes[k] < ideal do
+          k = k + 1
+        end
+        local point = keyframes[k]
+        if point and point - points[#points] >= options.segment_min_length / 2 and endTime - point >= options.segment_min_length / 2 then
+          points[#points + 1] = point
+        end
+      end
+      points[#points + 1] = endTime
+      return done(points)
+    end)
+  end)
+end
+local without_arguments
+without_arguments = function(command, prefixes)
+  local result = { }
+  for _index_0 = 1, #command do
+    local arg = command[_index_0]
+    local keep = true
+    for _index_1 = 1, #prefixes do
+      local prefix = prefixes[_index_1]
+      if arg:sub(1, #prefix) == prefix then
+        keep = false
+      end
+    end
+    if keep then
+      result[#result + 1] = arg
+    end
+  end
+  return result
+end
+local vp8_patch_step
+vp8_patch_step = function(out_path, duration)
+  return function()
+    return vp8_patch_logfile(get_pass_logfile_path(out_path), duration)
+  end
+end
+local encode_steps
+encode_steps = function(command, format, region, startTime, endTime, out_path, twopass)
+  local steps = { }
+  command = append({ }, command)
+  if twopass and format.supportsTwopass then
+    steps[#steps + 1] = append(append({ }, command), {
+      "--ovcopts-add=flags=+pass1"
+    })
+    if format.videoCodec == "libvpx" then
+      steps[#steps + 1] = vp8_patch_step(out_path, endTime - startTime)
+    end
+    append(command, {
+      "--ovcopts-add=flags=+pass2"
+    })
+  end
+  steps[#steps + 1] = format:postCommandModifier(command, region, startTime, endTime)
+  return steps
+end
+local ffmpeg_found = nil
+local check_ffmpeg
+check_ffmpeg = function(done)
+  if ffmpeg_found ~= nil then
+    return done(ffmpeg_found)
+  end
+  return mp.command_native_async({
+    name = "subprocess",
+    args = {
+      "ffmpeg",
+      "-version"
+    },
+    playback_only = false,
+    capture_stdout = true
+  }, function(success, result)
+    ffmpeg_found = success and result ~= nil and result.status == 0
+    return done(ffmpeg_found)
+  end)
+end
+local encode_segments_at
+local encode_in_segments
+encode_in_segments = function(command, format, region, path, startTime, endTime, out_path, is_temporary, fallback, done)
+  local count = math.min(options.parallel_segments, math.floor((endTime - startTime) / options.segment_min_length))
+  if count < 2 then
+    return fallback()
+  end
+  return check_ffmpeg(function(found)
+    if not found then
+      message("ffmpeg not found in PATH, encoding in one piece...")
+      msg.warn("parallel_segments needs ffmpeg to join the parts, encoding in one piece")
+      return fallback()
+    end
+    msg.verbose("Looking for keyframes to split the encode at")
+    return find_segment_points(path, startTime, endTime, count, function(points)
+      if not points or #points < 3 then
+        return fallback()
+      end
+      return encode_segments_at(command, format, region, path, points, out_path, is_temporary, fallback, done)
+    end)
+  end)
+end
+encode_segments_at = function(command, format, region, path, points, out_path, is_temporary, fallback, done)
+  local base, extension = out_path:match("^(.*)(%.[^%.]*)$")
+  local audio_path = nil
+  if format.audioCodec ~= "" then
+    audio_path = tostring(base) .. ".audio" .. tostring(extension)
+    for _index_0 = 1, #command do
+      if command[_index_0] == "--aid=no" then
+        audio_path = nil
+      end
+    end
+  end
+  local parts, jobs = { }, { }
+  if audio_path then
+    local audio_command = with_argument(command, "--o=", audio_path)
+    append(audio_command, {
+      "--vid=no"
+    })
+    jobs[#jobs + 1] = {
+      format:postCommandModifier(audio_command, region, points[1], points[#points])
+    }
+    command = without_arguments(command, {
+      "--lavfi-complex=",
+      "--audio-file="
+    })
+    append(command, {
+      "--aid=no"
+    })
+  end
+  for i = 1, #points - 1 do
+    local part_path = tostring(base) .. ".part" .. tostring(i) .. tostring(extension)
+    local part_start, part_end = points[i], points[i + 1]
+    local part_command = with_argument(command, "--start=", string.format("%.6f", part_start))
+    part_command = with_argument(part_command, "--end=", string.format("%.6f", part_end))
+    part_command = with_argument(part_command, "--o=", part_path)
+    parts[i] = part_path
+    jobs[#jobs + 1] = encode_steps(part_command, format, region, part_start, part_end, part_path, options.twopass)
+  end
+  local list_path = tostring(base) .. ".parts.txt"
+  local list = io.open(list_path, "wb")
+  if not list then
+    return fallback()
+  end
+  for _index_0 = 1, #parts do
+    list:write("file '" .. parts[_index_0]:gsub("'", "'\\''") .. "'\n")
+  end
+  list:close()
+  local finish
+  finish = function(ok)
+    for _index_0 = 1, #parts do
+      os.remove(parts[_index_0])
+      os.remove(get_pass_logfile_path(parts[_index_0]))
+    end
+    os.remove(list_path)
+    if audio_path then
+      os.remove(audio_path)
+    end
+    if is_temporary then
+      os.remove(path)
+    end
+    if ok then
+      message("Encoded successfully! Saved to\\N" .. tostring(bold(out_path)))
+      emit_event("encode-finished", "success")
+    else
+      message("Encode failed! Check the logs for details.")
+      emit_event("encode-finished", "fail")
+    end
+    if done then
+      return done(ok)
+    end
+  end
+  local join = {
+    "ffmpeg",
+    "-v",
+    "error",
+    "-y",
+    "-f",
+    "concat",
+    "-safe",
+    "0",
+    "-i",
+    list_path
+  }
+  if audio_path then
+    append(join, {
+      "-i",
+      audio_path,
+      "-map",
+      "0",
+      "-map",
+      "1:a"
+    })
+  else
+    append(join, {
+      "-map",
+      "0"
+    })
+  end
+  append(join, {
+    "-c",
+    "copy",
+    out_path
+  })
+  local workers = math.max(1, options.segment_workers)
+  message("Encoding " .. tostring(#parts) .. " segments, " .. tostring(workers) .. " at a time...")
+  msg.info("Encoding to", out_path, "in", #parts, "segments")
+  return run_jobs_in_parallel(jobs, workers, function(ok)
+    if not ok then
+      return finish(false)
+    end
+    return run_steps({
+      join
+    }, finish)
+  end)
+end
+local build_encode_job
+build_encode_job = function(region, startTime, endTime)
   local format = formats[options.output_format]
   local originalStartTime = startTime
   local originalEndTime = endTime
@@ -2684,61 +3761,38 @@ encode = function(region, startTime, endTime)
   append(command, {
     "--o=" .. tostring(out_path)
   })
-  emit_event("encode-started")
-  if options.twopass and format.supportsTwopass and not is_stream then
-    local first_pass_cmdline
-    do
-      local _accum_0 = { }
-      local _len_0 = 1
-      for _index_0 = 1, #command do
-        local arg = command[_index_0]
-        _accum_0[_len_0] = arg
-        _len_0 = _len_0 + 1
-      end
-      first_pass_cmdline = _accum_0
-    end
-    append(first_pass_cmdline, {
-      "--ovcopts-add=flags=+pass1"
-    })
-    message("Starting first pass...")
-    msg.verbose("First-pass command line: ", table.concat(first_pass_cmdline, " "))
-    local res = run_subprocess({
-      args = first_pass_cmdline,
-      cancellable = false
-    })
-    if not res then
-      message("First pass failed! Check the logs for details.")
-      emit_event("encode-finished", "fail")
-      return 
-    end
-    append(command, {
-      "--ovcopts-add=flags=+pass2"
-    })
-    if format.videoCodec == "libvpx" then
-      msg.verbose("Patching libvpx pass log file...")
-      vp8_patch_logfile(get_pass_logfile_path(out_path), endTime - startTime)
-    end
+  return {
+    command = command,
+    format = format,
+    region = region,
+    path = path,
+    is_stream = is_stream,
+    is_temporary = is_temporary,
+    startTime = startTime,
+    endTime = endTime,
+    out_path = out_path,
+    name = formatted_filename,
+    twopass = options.twopass and format.supportsTwopass and not is_stream
+  }
+end
+local encode_running = false
+local encode
+encode = function(region, startTime, endTime)
+  if encode_running then
+    message("An encode is already running. Press " .. tostring(bold('a')) .. " to add this one to the queue instead.")
+    return 
   end
-  command = format:postCommandModifier(command, region, startTime, endTime)
-  msg.info("Encoding to", out_path)
-  msg.verbose("Command line:", table.concat(command, " "))
-  if options.run_detached then
-    message("Started encode, process was detached.")
-    return utils.subprocess_detached({
-      args = command
-    })
-  else
-    local res = false
-    if not should_display_progress() then
-      message("Started encode...")
-      res = run_subprocess({
-        args = command,
-        cancellable = false
-      })
-    else
-      local ewp = EncodeWithProgress(startTime, endTime)
-      res = ewp:startEncode(command)
-    end
+  local job = build_encode_job(region, startTime, endTime)
+  if not job then
+    return 
+  end
+  local command, format, path, is_stream, is_temporary, out_path = job.command, job.format, job.path, job.is_stream, job.is_temporary, job.out_path
+  startTime, endTime = job.startTime, job.endTime
+  encode_running = true
+  emit_event("encode-started")
+  local finish
+  finish = function(res)
+    encode_running = false
     if res then
       message("Encoded successfully! Saved to\\N" .. tostring(bold(out_path)))
       emit_event("encode-finished", "success")
@@ -2751,6 +3805,187 @@ encode = function(region, startTime, endTime)
       return os.remove(path)
     end
   end
+  local encode_in_one_piece
+  encode_in_one_piece = function()
+    local steps = encode_steps(command, format, region, startTime, endTime, out_path, job.twopass)
+    local final_command = table.remove(steps)
+    local run_encode
+    run_encode = function()
+      msg.info("Encoding to", out_path)
+      msg.verbose("Command line:", table.concat(final_command, " "))
+      if options.run_detached then
+        encode_running = false
+        message("Started encode, process was detached.")
+        return utils.subprocess_detached({
+          args = final_command
+        })
+      elseif not should_display_progress() then
+        message("Started encode...")
+        return run_steps({
+          final_command
+        }, finish)
+      else
+        local ewp = EncodeWithProgress(startTime, endTime)
+        return ewp:startEncode(final_command, out_path, finish)
+      end
+    end
+    if #steps == 0 then
+      return run_encode()
+    end
+    message("Starting first pass...")
+    msg.verbose("First-pass command line: ", table.concat(steps[1], " "))
+    return run_steps(steps, function(res)
+      if not res then
+        encode_running = false
+        message("First pass failed! Check the logs for details.")
+        emit_event("encode-finished", "fail")
+        return 
+      end
+      return run_encode()
+    end)
+  end
+  if options.parallel_segments > 1 and not is_stream and not options.run_detached and format.videoCodec ~= "" and format.videoCodec ~= "gif" then
+    return encode_in_segments(command, format, region, path, startTime, endTime, out_path, is_temporary, encode_in_one_piece, function()
+      encode_running = false
+    end)
+  end
+  return encode_in_one_piece()
+end
+local encode_queue = { }
+local queue_page
+local run_queue
+run_queue = function()
+  local running = 0
+  for _index_0 = 1, #encode_queue do
+    if encode_queue[_index_0].state == "running" then
+      running = running + 1
+    end
+  end
+  for _index_0 = 1, #encode_queue do
+    local job = encode_queue[_index_0]
+    if running >= math.max(1, options.max_jobs) then
+      break
+    end
+    if job.state == "queued" then
+      running = running + 1
+      job.state = "running"
+      emit_event("encode-started")
+      msg.info("Encoding to", job.out_path)
+      run_steps(job.steps, function(ok)
+        job.state = ok and "done" or "failed"
+        os.remove(get_pass_logfile_path(job.out_path))
+        if job.is_temporary then
+          os.remove(job.path)
+        end
+        if not (queue_page and queue_page.visible) then
+          if ok then
+            message("Encoded successfully! Saved to\\N" .. tostring(bold(job.out_path)))
+          else
+            message("Encode failed! Check the logs for details.")
+          end
+        end
+        emit_event("encode-finished", ok and "success" or "fail")
+        return run_queue()
+      end)
+    end
+  end
+  if queue_page and queue_page.visible then
+    return queue_page:draw()
+  end
+end
+local enqueue_encode
+enqueue_encode = function(region, startTime, endTime)
+  local job = build_encode_job(region, startTime, endTime)
+  if not job then
+    return 
+  end
+  job.state = "queued"
+  job.steps = encode_steps(job.command, job.format, job.region, job.startTime, job.endTime, job.out_path, job.twopass)
+  encode_queue[#encode_queue + 1] = job
+  message("Added " .. tostring(bold(job.name)) .. " to the encode queue")
+  return run_queue()
+end
+local queue_file = "~~/webm-queue.json"
+local save_queue
+save_queue = function()
+  local saved = { }
+  local path = mp.command_native({
+    "expand-path",
+    queue_file
+  })
+  local file = io.open(path, "r")
+  if file then
+    local earlier = utils.parse_json(file:read("*a") or "")
+    file:close()
+    if type(earlier) == "table" then
+      append(saved, earlier)
+    end
+  end
+  local unfinished = 0
+  for _index_0 = 1, #encode_queue do
+    local job = encode_queue[_index_0]
+    if job.state == "queued" or job.state == "running" then
+      local steps = { }
+      for i = 1, #job.steps do
+        local step = job.steps[i]
+        steps[i] = type(step) == "function" and "patch-vp8-log" or step
+      end
+      saved[#saved + 1] = {
+        name = job.name,
+        out_path = job.out_path,
+        path = job.path,
+        is_temporary = job.is_temporary,
+        startTime = job.startTime,
+        endTime = job.endTime,
+        steps = steps
+      }
+      unfinished = unfinished + 1
+    end
+  end
+  if unfinished == 0 then
+    return 
+  end
+  file = io.open(path, "w")
+  if not file then
+    msg.warn("Could not save the encode queue to", path)
+    return 
+  end
+  file:write(utils.format_json(saved))
+  return file:close()
+end
+local load_queue
+load_queue = function()
+  local path = mp.command_native({
+    "expand-path",
+    queue_file
+  })
+  local claimed = path .. "." .. tostring(mp.get_property("pid", "0"))
+  if not os.rename(path, claimed) then
+    return 
+  end
+  local file = io.open(claimed, "r")
+  local saved = file and utils.parse_json(file:read("*a") or "")
+  if file then
+    file:close()
+  end
+  os.remove(claimed)
+  if type(saved) ~= "table" then
+    return 
+  end
+  for _index_0 = 1, #saved do
+    local job = saved[_index_0]
+    for i = 1, #job.steps do
+      if job.steps[i] == "patch-vp8-log" then
+        job.steps[i] = vp8_patch_step(job.out_path, job.endTime - job.startTime)
+      end
+    end
+    job.state = "queued"
+    encode_queue[#encode_queue + 1] = job
+  end
+  if #saved > 0 then
+    message("Resuming " .. tostring(#saved) .. " queued encodes from the last session")
+    return run_queue()
+  end
 end
 local CropPage
 do
@@ -3507,67 +4742,173 @@ do
   end
   PreviewPage = _class_0
 end
-local MainPage
+local QueuePage
 do
   local _class_0
   local _parent_0 = Page
   local _base_0 = {
-    setStartTime = function(self)
-      self.startTime = mp.get_property_number("time-pos")
-      if self.visible then
-        self:clear()
-        return self:draw()
-      end
-    end,
-    setEndTime = function(self)
-      self.endTime = mp.get_property_number("time-pos")
-      if self.visible then
-        self:clear()
-        return self:draw()
-      end
-    end,
-    jumpToStartTime = function(self)
-      return mp.set_property("time-pos", self.startTime)
-    end,
-    jumpToEndTime = function(self)
-      return mp.set_property("time-pos", self.endTime)
-    end,
-    setupStartAndEndTimes = function(self)
-      if mp.get_property_native("duration") then
-        self.startTime = 0
-        self.endTime = mp.get_property_native("duration")
-      else
-        self.startTime = -1
-        self.endTime = -1
-      end
-      if self.visible then
-        self:clear()
-        return self:draw()
-      end
-    end,
     draw = function(self)
       local window_w, window_h = mp.get_osd_size()
       local ass = assdraw.ass_new()
       ass:new_event()
       self:setup_text(ass)
-      ass:append(tostring(bold('WebM maker')) .. "\\N\\N")
-      ass:append(tostring(bold('c:')) .. " crop\\N")
-      ass:append(tostring(bold('1:')) .. " set start time (current is " .. tostring(seconds_to_time_string(self.startTime)) .. ")\\N")
-      ass:append(tostring(bold('2:')) .. " set end time (current is " .. tostring(seconds_to_time_string(self.endTime)) .. ")\\N")
-      ass:append(tostring(bold('!:')) .. " jump to start time\\N")
-      ass:append(tostring(bold('@:')) .. " jump to end time\\N")
-      ass:append(tostring(bold('o:')) .. " change encode options\\N")
-      ass:append(tostring(bold('p:')) .. " preview\\N")
-      ass:append(tostring(bold('e:')) .. " encode\\N\\N")
-      ass:append(tostring(bold('ESC:')) .. " close\\N")
+      local counts = {
+        queued = 0,
+        running = 0,
+        done = 0,
+        failed = 0
+      }
+      for _index_0 = 1, #encode_queue do
+        local job = encode_queue[_index_0]
+        counts[job.state] = counts[job.state] + 1
+      end
+      ass:append(tostring(bold('Encode queue')) .. "\\N")
+      ass:append(tostring(counts.running) .. " encoding, " .. tostring(counts.queued) .. " waiting, " .. tostring(counts.done) .. " done, " .. tostring(counts.failed) .. " failed (" .. tostring(math.max(1, options.max_jobs)) .. " at a time)\\N\\N")
+      for i = 1, #encode_queue do
+        local job = encode_queue[i]
+        local state = job.state
+        if state == "running" then
+          state = bold("encoding")
+        end
+        ass:append(tostring(i) .. ". [" .. tostring(state) .. "] " .. tostring(job.name) .. "\\N")
+      end
+      if #encode_queue == 0 then
+        ass:append("Nothing queued. Press " .. tostring(bold('a')) .. " in the menu to add the current clip.\\N")
+      end
+      ass:append("\\N")
+      ass:append(tostring(bold('c:')) .. " clear finished\\N")
+      ass:append(tostring(bold('ESC:')) .. " back\\N")
       return mp.set_osd_ass(window_w, window_h, ass.text)
     end,
-    show = function(self)
-      _class_0.__parent.show(self)
-      return emit_event("show-main-page")
-    end,
-    onUpdateCropRegion = function(self, updated, newRegion)
-      if updated then
+    clearFinished = function(self)
+      local kept = { }
+      for _index_0 = 1, #encode_queue do
+        local job = encode_queue[_index_0]
+        if job.state == "queued" or job.state == "running" then
+          kept[#kept + 1] = job
+        end
+      end
+      encode_queue = kept
+      self:clear()
+      return self:draw()
+    end,
+    close = function(self)
+      self:hide()
+      return self.callback()
+    end
+  }
+  _base_0.__index = _base_0
+  setmetatable(_base_0, _parent_0.__base)
+  _class_0 = setmetatable({
+    __init = function(self, callback)
+      self.callback = callback
+      self.keybinds = {
+        ["c"] = (function()
+          local _base_1 = self
+          local _fn_0 = _base_1.clearFinished
+          return function(...)
+            return _fn_0(_base_1, ...)
+          end
+        end)(),
+        ["ESC"] = (function()
+          local _base_1 = self
+          local _fn_0 = _base_1.close
+          return function(...)
+            return _fn_0(_base_1, ...)
+          end
+        end)()
+      }
+    end,
+    __base = _base_0,
+    __name = "QueuePage",
+    __parent = _parent_0
+  }, {
+    __index = function(cls, name)
+      local val = rawget(_base_0, name)
+      if val == nil then
+        local parent = rawget(cls, "__parent")
+        if parent then
+          return parent[name]
+        end
+      else
+        return val
+      end
+    end,
+    __call = function(cls, ...)
+      local _self_0 = setmetatable({}, _base_0)
+      cls.__init(_self_0, ...)
+      return _self_0
+    end
+  })
+  _base_0.__class = _class_0
+  if _parent_0.__inherited then
+    _parent_0.__inherited(_parent_0, _class_0)
+  end
+  QueuePage = _class_0
+end
+local MainPage
+do
+  local _class_0
+  local _parent_0 = Page
+  local _base_0 = {
+    setStartTime = function(self)
+      self.startTime = mp.get_property_number("time-pos")
+      if self.visible then
+        self:clear()
+        return self:draw()
+      end
+    end,
+    setEndTime = function(self)
+      self.endTime = mp.get_property_number("time-pos")
+      if self.visible then
+        self:clear()
+        return self:draw()
+      end
+    end,
+    jumpToStartTime = function(self)
+      return mp.set_property("time-pos", self.startTime)
+    end,
+    jumpToEndTime = function(self)
+      return mp.set_property("time-pos", self.endTime)
+    end,
+    setupStartAndEndTimes = function(self)
+      if mp.get_property_native("duration") then
+        self.startTime = 0
+        self.endTime = mp.get_property_native("duration")
+      else
+        self.startTime = -1
+        self.endTime = -1
+      end
+      if self.visible then
+        self:clear()
+        return self:draw()
+      end
+    end,
+    draw = function(self)
+      local window_w, window_h = mp.get_osd_size()
+      local ass = assdraw.ass_new()
+      ass:new_event()
+      self:setup_text(ass)
+      ass:append(tostring(bold('WebM maker')) .. "\\N\\N")
+      ass:append(tostring(bold('c:')) .. " crop\\N")
+      ass:append(tostring(bold('1:')) .. " set start time (current is " .. tostring(seconds_to_time_string(self.startTime)) .. ")\\N")
+      ass:append(tostring(bold('2:')) .. " set end time (current is " .. tostring(seconds_to_time_string(self.endTime)) .. ")\\N")
+      ass:append(tostring(bold('!:')) .. " jump to start time\\N")
+      ass:append(tostring(bold('@:')) .. " jump to end time\\N")
+      ass:append(tostring(bold('o:')) .. " change encode options\\N")
+      ass:append(tostring(bold('p:')) .. " preview\\N")
+      ass:append(tostring(bold('e:')) .. " encode\\N")
+      ass:append(tostring(bold('a:')) .. " add to encode queue\\N")
+      ass:append(tostring(bold('j:')) .. " show encode queue (" .. tostring(#encode_queue) .. " jobs)\\N\\N")
+      ass:append(tostring(bold('ESC:')) .. " close\\N")
+      return mp.set_osd_ass(window_w, window_h, ass.text)
+    end,
+    show = function(self)
+      _class_0.__parent.show(self)
+      return emit_event("show-main-page")
+    end,
+    onUpdateCropRegion = function(self, updated, newRegion)
+      if updated then
         self.region = newRegion
       end
       return self:show()
@@ -3611,21 +4952,49 @@ do
       end)(), self.region, self.startTime, self.endTime)
       return previewPage:show()
     end,
-    encode = function(self)
-      self:hide()
+    checkTimes = function(self)
       if self.startTime < 0 then
         message("No start time, aborting")
-        return 
+        return false
       end
       if self.endTime < 0 then
         message("No end time, aborting")
-        return 
+        return false
       end
       if self.startTime >= self.endTime then
         message("Start time is ahead of end time, aborting")
+        return false
+      end
+      return true
+    end,
+    encode = function(self)
+      self:hide()
+      if not self:checkTimes() then
         return 
       end
       return encode(self.region, self.startTime, self.endTime)
+    end,
+    addToQueue = function(self)
+      if not self:checkTimes() then
+        return 
+      end
+      enqueue_encode(self.region, self.startTime, self.endTime)
+      self:clear()
+      return self:draw()
+    end,
+    onQueueClosed = function(self)
+      return self:show()
+    end,
+    showQueue = function(self)
+      self:hide()
+      queue_page = QueuePage((function()
+        local _base_1 = self
+        local _fn_0 = _base_1.onQueueClosed
+        return function(...)
+          return _fn_0(_base_1, ...)
+        end
+      end)())
+      return queue_page:show()
     end
   }
   _base_0.__index = _base_0
@@ -3689,6 +5058,20 @@ do
             return _fn_0(_base_1, ...)
           end
         end)(),
+        ["a"] = (function()
+          local _base_1 = self
+          local _fn_0 = _base_1.addToQueue
+          return function(...)
+            return _fn_0(_base_1, ...)
+          end
+        end)(),
+        ["j"] = (function()
+          local _base_1 = self
+          local _fn_0 = _base_1.showQueue
+          return function(...)
+            return _fn_0(_base_1, ...)
+          end
+        end)(),
         ["ESC"] = (function()
           local _base_1 = self
           local _fn_0 = _base_1.hide
@@ -3746,75 +5129,1427 @@ mp.register_event("file-loaded", (function()
     return _fn_0(_base_0, ...)
   end
 end)())
+mp.register_event("shutdown", save_queue)
+load_queue()
 msg.verbose("Loaded mpv-webm script!")
 return emit_event("script-loaded")
 )x";
-    cout<<"successfully created webm.lua... "<<endl;
+
+
+// contents of script-opts\webm.conf
+constexpr char webm_config_source[] = R"x(crf=30
+display_progress=true
+apply_video_filters=no
+twopass=no
+output_format=avc)x";
+
+
+// every file the installer writes. the files don't depend on each other so they can be written at the same time
+constexpr embedded_asset embedded_assets[] = {
+    make_embedded_asset<mpv_conf_source>(        "mpv.conf",         "mpv.conf"),
+    make_embedded_asset<input_conf_source>(      "input.conf",       "input.conf"),
+    make_embedded_asset<notes_txt_source>(       "notes.txt",        "notes.txt"),
+    make_embedded_asset<autoload_lua_source>(    "autoload.lua",     "scripts/autoload.lua"),
+    make_embedded_asset<mpv_chapters_js_source>( "mpv_chapters.js",  "scripts/mpv_chapters.js"),
+    make_embedded_asset<webm_lua_source>(        "webm.lua",         "scripts/webm.lua"),
+    make_embedded_asset<webm_config_source>(     "webm.conf",        "script-opts/webm.conf"),
+};
+
+constexpr size_t asset_count = sizeof(embedded_assets) / sizeof(embedded_assets[0]);
+
+constexpr bool same_name(const char* a, const char* b){
+    while (*a && *a == *b){
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+constexpr size_t find_asset(const char* name){     // number of the asset called name, or asset_count if there is none. works at compile time too
+    for (size_t i = 0; i < asset_count; i++){
+        if (same_name(embedded_assets[i].name, name)) return i;
+    }
+    return asset_count;
 }
 
+static_assert(find_asset("webm.lua") < asset_count, "webm.lua must be in embedded_assets");
+
+const vector<string> target_directories = {
+    ".",                                    // the config folder itself
+    "scripts",
+    "script-opts",                          // folder for webm.conf
+    "bin",                                  // this program again, autoload.lua runs it to sort big folders
+    "autoload-cache",                       // the sorted folder lists it writes
+};
 
-void make_webm_config_file(string path_upto_username){
-        
 
-    std::filesystem::create_directories(path_upto_username+"AppData\\Roaming\\mpv\\script-opts\\" );
-    ofstream file_writer( path_upto_username+"AppData\\Roaming\\mpv\\script-opts\\webm.conf" ); // file_writer is just a named object which can write things
-    if ( ! file_writer.is_open() ){ // checking if the file is opened 
-        cout << "Could not open file!" << '\n';
-        return;
+// instrumentation: counters of the file operations our own helpers do (write_file_raw, sync_to_disk, rename_file...),
+// and scoped_timer, which times one step of the install. with "--trace FILE" every timed step is also kept as a trace event
+// and written to FILE at the end, in the chrome trace event json format (chrome://tracing, perfetto, or any dashboard that reads json).
+// the counters count what the installer asks for, not what the OS does, but every open/write/fsync of the install goes through these helpers.
+
+struct io_counters{
+    atomic<uint64_t> opens{0};
+    atomic<uint64_t> writes{0};
+    atomic<uint64_t> fsyncs{0};
+    atomic<uint64_t> renames{0};
+    atomic<uint64_t> bytes_written{0};
+    atomic<uint64_t> errors{0};                     // any of the above that failed
+};
+
+io_counters io_count;
+
+struct trace_event{
+    string name;
+    string category;
+    double start_microseconds;                      // since the program started
+    double duration_microseconds;
+    unsigned thread_number;
+};
+
+const auto program_started = chrono::steady_clock::now();
+atomic<bool> tracing{false};                        // only keep events when --trace asked for them
+mutex trace_events_lock;
+vector<trace_event> trace_events;
+atomic<unsigned> next_thread_number{0};
+thread_local unsigned thread_number = next_thread_number++;
+
+
+class scoped_timer{                                 // measures from creation to the end of the scope it lives in
+public:
+    scoped_timer(string name, string category, double* milliseconds = nullptr)
+        : name(move(name)), category(move(category)), milliseconds(milliseconds), started(chrono::steady_clock::now()) {}
+
+    ~scoped_timer(){
+        auto finished = chrono::steady_clock::now();
+        if (milliseconds) *milliseconds = chrono::duration<double, milli>(finished - started).count();
+        if ( ! tracing ) return;
+        lock_guard<mutex> hold(trace_events_lock);
+        trace_events.push_back({ name, category, chrono::duration<double, micro>(started - program_started).count(),
+                                 chrono::duration<double, micro>(finished - started).count(), thread_number });
     }
 
-    // raw string syntax is rawstring = R"(ghuiyanlassan)" 
-    // raw string keep the \n,\t and other thing as same it is without conveying any meaning
+private:
+    string name, category;
+    double* milliseconds;                           // also handed back to the caller if it wants it
+    chrono::steady_clock::time_point started;
+};
 
-    file_writer<<R"x(crf=30
-display_progress=true
-apply_video_filters=no
-twopass=no
-output_format=avc)x";
-    cout<<"successfully created webm.conf... "<<endl;
+
+string json_escape(const string& text){     // just enough escaping for paths and messages
+    string escaped;
+    for (char c : text){
+        if (c == '"' || c == '\\') escaped += '\\';
+        if ((unsigned char)c < 0x20){
+            escaped += ' ';
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
 }
 
 
+string trace_json(){ // every kept event as a complete ("X") event, then the io counters as one counter ("C") event at the end
+    ostringstream json;
+    json<<fixed<<setprecision(3)<<"{\"traceEvents\":[";
+    lock_guard<mutex> hold(trace_events_lock);
+    for (const trace_event& event : trace_events){
+        json<<"{\"name\":\""<<json_escape(event.name)<<"\",\"cat\":\""<<json_escape(event.category)<<"\",\"ph\":\"X\","
+            <<"\"ts\":"<<event.start_microseconds<<",\"dur\":"<<event.duration_microseconds<<",\"pid\":1,\"tid\":"<<event.thread_number<<"},";
+    }
+    json<<"{\"name\":\"io\",\"ph\":\"C\",\"ts\":"<<chrono::duration<double, micro>(chrono::steady_clock::now() - program_started).count()
+        <<",\"pid\":1,\"args\":{\"opens\":"<<io_count.opens<<",\"writes\":"<<io_count.writes<<",\"fsyncs\":"<<io_count.fsyncs
+        <<",\"renames\":"<<io_count.renames<<",\"bytes_written\":"<<io_count.bytes_written<<",\"errors\":"<<io_count.errors<<"}}]}"<<'\n';
+    return json.str();
+}
+
 
-string return_path_upto_username(string username){ // defining a function to return the path upto the username only in string datatype. it takes arguement username that will be taken from the user.
-    string left_path,right_path,fullpath;
-    left_path = "C:\\Users\\" ;
-    right_path = "\\";
-    fullpath=left_path+username+right_path;
-    return fullpath;                               // return value of path will look something like "C:\Users\jhonny_D" or "C:\Users\Koby"  
+void rename_file(const std::filesystem::path& from, const std::filesystem::path& to, error_code& error){ // replaces "to" in one step, it is never missing in between
+    io_count.renames++;
+#ifdef _WIN32
+    error.clear();
+    if ( ! MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ){
+        error = error_code((int)GetLastError(), system_category());
+    }
+#else
+    std::filesystem::rename(from, to, error);   // rename(2) swaps the directory entry atomically
+#endif
+    if (error) io_count.errors++;
 }
 
 
-int main(){
-    string username, fullpath_after_verifying_if_it_exists,path_upto_username ;
-    cout<<"Enter windows username : ";
-    cin>>username ;        //  please note that username is not case sensitive in windows
-    
-    std::filesystem::path filepath = std::string(return_path_upto_username(username));
-    bool filepathExists = std::filesystem::is_directory(filepath);  // filepathExists will return true if path really exists
-    path_upto_username = return_path_upto_username(username);       // we can't call this function in other functions so we will first store in the string varibale
+bool unpack_asset(const embedded_asset& asset, string& text){ // undoes lz_pack. text ends up exactly asset.size long, so it can go to disk in one write
+    text.assign(asset.size, '\0');
+    const unsigned char* packed = asset.packed;
+    size_t i = 0, unpacked = 0;
+
+    while (i < asset.packed_size){
+        unsigned flags = packed[i++];
+        for (int token = 0; token < 8 && i < asset.packed_size; token++){
+            if (flags >> token & 1){
+                size_t distance = packed[i] | packed[i+1] << 8;
+                size_t length = packed[i+2] + min_match;
+                i += 3;
+                if (distance == 0 || distance > unpacked || unpacked + length > asset.size) return false;
+                for (size_t k = 0; k < length; k++, unpacked++){
+                    text[unpacked] = text[unpacked - distance];     // one by one, a copy can overlap the bytes it is making
+                }
+            }
+            else{
+                if (unpacked == asset.size) return false;
+                text[unpacked++] = (char)packed[i++];
+            }
+        }
+    }
+    return unpacked == asset.size;
+}
 
-    if (filepathExists == true){     // don't do anything if the path exists.
-        cout<<endl<<"Correct username!"<<endl<<endl;
-        fullpath_after_verifying_if_it_exists = return_path_upto_username(username) + "AppData\\Roaming\\mpv\\scripts";
 
-        std::filesystem::create_directories(fullpath_after_verifying_if_it_exists);     // creates "mpv" folder then "scripts" folder inside it.
+string file_contents_of(const embedded_asset& asset){ // the exact bytes that go on disk, empty if the asset doesn't unpack
+    string text;
+    if ( ! unpack_asset(asset, text) ) return "";
+#ifdef _WIN32
+    string windows_text;                    // the old text mode ofstream wrote \r\n on windows, keep doing that
+    windows_text.reserve(text.size() + text.size() / 16);
+    for (char c : text){
+        if (c == '\n') windows_text += '\r';
+        windows_text += c;
+    }
+    return windows_text;
+#else
+    return text;
+#endif
+}
 
-        make_mpv_conf_file(path_upto_username);         // make the mpv.conf file in the directory after adding "path_to_username" to the leftover path
-        make_input_conf_file(path_upto_username);       // make the input.conf file in the directory after adding "path_to_username" to the leftover path
-        make_notes_txt_file(path_upto_username);        // make the notes.txt file in the directory after adding "path_to_username" to the leftover path
-        make_autoload_lua_file(path_upto_username);     // make the autoload.lua file in the directory after adding "path_to_username" to the leftover path
-        make_mpv_chapters_js_file(path_upto_username);  // make the mpv_chapters.js file in the directory after adding "path_to_username" to the leftover path
-        make_webm_lua_file(path_upto_username);
-        make_webm_config_file(path_upto_username);
+
+error_code write_file_raw(const std::filesystem::path& file_path, const string& contents){ // no iostream: open, reserve the file's space, then one write. returns what went wrong, empty if nothing
+    int error = 0;                          // the errno of the first step that failed
+#ifdef _WIN32
+    io_count.opens++;
+    int fd = _wopen(file_path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd < 0){
+        io_count.errors++;
+        return error_code(errno, generic_category());
+    }
+    if ( ! contents.empty() ){              // only a hint to reserve the clusters, nothing is written (_chsize_s would write the whole file as zeros first)
+        FILE_ALLOCATION_INFO allocation;
+        allocation.AllocationSize.QuadPart = (LONGLONG)contents.size();
+        if ( ! SetFileInformationByHandle((HANDLE)_get_osfhandle(fd), FileAllocationInfo, &allocation, sizeof(allocation))
+            && GetLastError() == ERROR_DISK_FULL){
+            error = ENOSPC;                 // any other failure (FAT32, network shares) is ignored, the write below still tells
+        }
+    }
+    size_t done = 0;
+    while (error == 0 && done < contents.size()){
+        io_count.writes++;
+        int chunk = _write(fd, contents.data() + done, (unsigned)min<size_t>(contents.size() - done, 1u << 30));
+        if (chunk < 0) error = errno;
+        else if (chunk == 0) error = ENOSPC;
+        else done += (size_t)chunk;
+    }
+    io_count.bytes_written += done;
+    if (_close(fd) != 0 && error == 0) error = errno;
+#else
+    io_count.opens++;
+    int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);   // 0666 minus umask, same as ofstream
+    if (fd < 0){
+        io_count.errors++;
+        return error_code(errno, generic_category());
+    }
+    if ( ! contents.empty() ){
+        error = posix_fallocate(fd, 0, (off_t)contents.size());      // reserves the space up front without writing, so on linux a full disk fails here and not halfway. returns the error, doesn't set errno
+        if (error == EINVAL || error == EOPNOTSUPP){                 // some filesystems (tmpfs on old kernels, network mounts) can't, that's fine
+            error = 0;
+        }
+    }
+    size_t done = 0;
+    while (error == 0 && done < contents.size()){   // one pwrite does it, the loop is only for a short write from a signal
+        io_count.writes++;
+        ssize_t chunk = pwrite(fd, contents.data() + done, contents.size() - done, (off_t)done);
+        if (chunk < 0 && errno == EINTR) continue;
+        if (chunk < 0) error = errno;
+        else if (chunk == 0) error = ENOSPC;
+        else done += (size_t)chunk;
+    }
+    io_count.bytes_written += done;
+    if (close(fd) != 0 && error == 0) error = errno;
+#endif
+    if (error != 0) io_count.errors++;
+    return error_code(error, generic_category());
+}
 
 
+bool write_file_with_ofstream(const std::filesystem::path& file_path, const string& contents){ // the old iostream way, only kept for --bench-write to compare against
+    ofstream file_writer( file_path, ios::binary ); // binary because contents already has the right line endings
+    if ( ! file_writer.is_open() ){
+        return false;
     }
-    else{     // don't do anything if the path don't exists.
-        cout<<"Incorrect username please try again or check username from C:\\Users\\username"<<endl<<endl;
+    file_writer<<contents;
+    file_writer.close();
+    return ! file_writer.fail();
+}
+
+
+error_code write_asset(const embedded_asset& asset, const std::filesystem::path& file_path){ // the one write path for every file. returns what went wrong, empty if nothing
+    string contents = file_contents_of(asset);
+    if (contents.empty() && asset.size != 0) return make_error_code(errc::illegal_byte_sequence);    // the packed copy inside this exe is broken
+    return write_file_raw(file_path, contents);
+}
+
+
+struct asset_job_result{
+    string file_name;
+    bool written = false;
+    string error;                           // what the system said when it failed, like "Permission denied"
+    double milliseconds = 0;                // how long this one file took, open + write + close
+};
+
+
+// --batch and --root are usually run as root, for homes that belong to somebody else. everything the install creates is given to
+// the owner of the folder it goes into, otherwise mpv (running as that user) can't write its autoload-cache and the user can't edit the config.
+
+struct folder_owner{
+    bool change = false;                    // only when running as root for another user. never on windows, where the new files inherit the folder's permissions
+#ifndef _WIN32
+    uid_t uid = 0;
+    gid_t gid = 0;
+#endif
+};
+
+
+folder_owner owner_of_folder(const std::filesystem::path& path){ // the owner of path, or of the nearest folder above it that exists
+    folder_owner owner;
+#ifndef _WIN32
+    error_code error;
+    std::filesystem::path folder = std::filesystem::absolute(path, error);
+    if (error) return owner;
+    struct stat info;
+    while (stat(folder.c_str(), &info) != 0){
+        if (folder == folder.parent_path()) return owner;
+        folder = folder.parent_path();
     }
-    system("pause");  // for a nice "press any key to continue...." and kept it open
-    
+    owner.change = geteuid() == 0 && info.st_uid != 0;
+    owner.uid = info.st_uid;
+    owner.gid = info.st_gid;
+#endif
+    return owner;
+}
 
-    return 0;
+
+error_code give_to_owner(const std::filesystem::path& path, const folder_owner& owner){ // empty if it worked or nothing had to change
+#ifndef _WIN32
+    if (owner.change && lchown(path.c_str(), owner.uid, owner.gid) != 0){     // lchown: a symlink planted in the home is never followed
+        return error_code(errno, generic_category());
+    }
+#else
+    (void)path;
+    (void)owner;
+#endif
+    return {};
+}
+
+
+bool make_target_directories(const std::filesystem::path& config_root, const folder_owner& owner){ // creates every folder once before any file is written, so the writer threads never race on create_directories
+    error_code error;                       // error_code version doesn't throw, we just report it
+    for (const string& directory : target_directories){
+        vector<std::filesystem::path> missing;      // ~/.config too when it didn't exist yet, not only the mpv folders
+        for (std::filesystem::path folder = config_root / directory; ! folder.empty() && ! std::filesystem::exists(folder, error); folder = folder.parent_path()){
+            missing.push_back(folder);
+            if (folder == folder.parent_path()) break;
+        }
+        std::filesystem::create_directories(config_root / directory, error);
+        if (error) return false;
+        for (const std::filesystem::path& folder : missing){
+            if (give_to_owner(folder, owner)) return false;
+        }
+    }
+    return true;
+}
+
+
+thread_local bool inside_worker = false;    // set on pool threads, so a run_in_parallel inside another one doesn't start threads of its own
+
+void run_in_parallel(size_t job_count, const function<void(size_t)>& run_job){ // runs run_job(0) ... run_job(job_count-1) over a small thread pool
+    if (inside_worker){                     // already spread out one level up (batch mode: one profile per worker)
+        for (size_t i = 0; i < job_count; i++){
+            run_job(i);
+        }
+        return;
+    }
+    atomic<size_t> next_job{0};             // every worker picks the next job number from here until all of them are taken
+
+    auto worker = [&](){
+        inside_worker = true;
+        for (size_t i = next_job++; i < job_count; i = next_job++){
+            run_job(i);
+        }
+        inside_worker = false;
+    };
+
+    size_t thread_count = min<size_t>(job_count, max(1u, thread::hardware_concurrency()));
+    vector<thread> pool;
+    for (size_t t = 1; t < thread_count; t++){
+        pool.emplace_back(worker);
+    }
+    worker();                               // main thread works too instead of only waiting
+    for (thread& t : pool){
+        t.join();
+    }
+}
+
+
+// the manifest remembers what the installer wrote last time: the hash of each text, and the size and modified time of the file on disk.
+// a file that still matches its entry is skipped without even reading it. otherwise the file is hashed and only rewritten if the hash differs.
+
+const string manifest_relative_path = "mpv_config.manifest";
+#ifdef _WIN32
+const std::filesystem::path helper_relative_path = "bin/mpv_config.exe";    // the native helper, see install_native_helper
+#else
+const std::filesystem::path helper_relative_path = "bin/mpv_config";
+#endif
+
+struct manifest_entry{
+    uint64_t hash = 0;                      // content_hash of the embedded text that was written
+    uintmax_t disk_size = 0;                // size on disk, not the text size (windows writes \r\n)
+    long long modified_time = 0;            // last_write_time of the file, in file clock ticks
+};
+
+
+bool stat_file(const std::filesystem::path& path, uintmax_t& disk_size, long long& modified_time){
+    error_code error;
+    disk_size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    modified_time = (long long)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    return ! error;
+}
+
+
+bool file_hashes_to(const std::filesystem::path& path, uint64_t expected_hash){ // hashes a file from disk. text mode so that \r\n on windows reads back as the \n of the raw string
+    io_count.opens++;
+    ifstream file_reader( path );
+    if ( ! file_reader.is_open() ) return false;
+
+    uint64_t hash = content_hash(nullptr, 0);
+    char buffer[64 * 1024];
+    while (file_reader.read(buffer, sizeof(buffer)) || file_reader.gcount() > 0){
+        hash = content_hash(buffer, (size_t)file_reader.gcount(), hash);
+    }
+    return hash == expected_hash;
+}
+
+
+map<string, manifest_entry> read_manifest(const std::filesystem::path& config_root){ // a missing or broken manifest is just an empty one, every file gets hashed then
+    map<string, manifest_entry> manifest;
+    io_count.opens++;
+    ifstream manifest_reader( config_root / manifest_relative_path );
+    string line;
+    while (getline(manifest_reader, line)){
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        manifest_entry entry;
+        string relative_path;
+        if (fields >> hex >> entry.hash >> dec >> entry.disk_size >> entry.modified_time >> ws && getline(fields, relative_path)){
+            manifest[relative_path] = entry;
+        }
+    }
+    return manifest;
+}
+
+
+bool write_manifest(const std::filesystem::path& config_root, const folder_owner& owner){ // records every installed file as it is on disk now. written next to the target and renamed, like the other files
+    scoped_timer timer("manifest", "install");
+    std::filesystem::path manifest_path = config_root / manifest_relative_path;
+    std::filesystem::path staged_manifest_path = manifest_path;
+    staged_manifest_path += ".installing";
+
+    ostringstream manifest_writer;
+    manifest_writer<<"# written by mpv_config. delete this file to force a full rewrite of the config"<<'\n';
+    for (const embedded_asset& asset : embedded_assets){
+        uintmax_t disk_size = 0;
+        long long modified_time = 0;
+        if (stat_file(config_root / asset.relative_path, disk_size, modified_time)){
+            manifest_writer<<hex<<asset.hash<<dec<<' '<<disk_size<<' '<<modified_time<<' '<<asset.relative_path<<'\n';
+        }
+    }
+
+    error_code error;
+    if ( ! write_file_raw(staged_manifest_path, manifest_writer.str()) && ! give_to_owner(staged_manifest_path, owner) ){
+        rename_file(staged_manifest_path, manifest_path, error);
+        if ( ! error ) return true;
+    }
+    std::filesystem::remove(staged_manifest_path, error);
+    return false;
+}
+
+
+vector<size_t> find_changed_assets(const std::filesystem::path& config_root, uintmax_t& skipped_bytes){ // returns the numbers of the embedded_assets that really need writing
+    scoped_timer timer("compare", "install");
+    map<string, manifest_entry> manifest = read_manifest(config_root);
+    vector<char> unchanged(asset_count, false);
+
+    run_in_parallel(asset_count, [&](size_t i){
+        const embedded_asset& asset = embedded_assets[i];
+        std::filesystem::path target_path = config_root / asset.relative_path;
+        uintmax_t disk_size = 0;
+        long long modified_time = 0;
+        if ( ! stat_file(target_path, disk_size, modified_time) ) return;   // not there yet
+
+        auto entry = manifest.find(asset.relative_path);
+        if (entry != manifest.end() && entry->second.hash == asset.hash &&
+            entry->second.disk_size == disk_size && entry->second.modified_time == modified_time){
+            unchanged[i] = true;            // untouched since we wrote it
+            return;
+        }
+        unchanged[i] = file_hashes_to(target_path, asset.hash);         // touched or no manifest, compare the contents
+    });
+
+    vector<size_t> changed_jobs;
+    skipped_bytes = 0;
+    for (size_t i = 0; i < asset_count; i++){
+        if (unchanged[i]){
+            skipped_bytes += embedded_assets[i].size;
+        }
+        else{
+            changed_jobs.push_back(i);
+        }
+    }
+    return changed_jobs;
+}
+
+
+// the install is a small transaction: every file is first written next to its target as "name.installing",
+// then all of them are synced to disk in one pass, and only then renamed over the live files.
+// the rename replaces the live file in one step, so a target is always either the old file or the new one, never missing.
+// before that, the old file gets a second name "name.previous" (a hard link, or a copy), so a failure at any step puts the old tree back.
+// a run that was killed halfway leaves those names behind, and the next run puts the old files back first (see recover_interrupted_install).
+// every step takes the list of embedded_assets numbers that need installing (see find_changed_assets).
+
+std::filesystem::path staged_path_of(std::filesystem::path target_path){
+    return target_path += ".installing";
+}
+
+std::filesystem::path backup_path_of(std::filesystem::path target_path){
+    return target_path += ".previous";
+}
+
+
+bool sync_to_disk(const std::filesystem::path& path, bool is_directory = false){ // fsync for one file (or folder, on linux), so a crash can't leave it half written
+#ifdef _WIN32
+    if (is_directory) return true;          // windows has no way to sync a folder entry, NTFS journals the rename itself
+    io_count.opens++;
+    int fd = _wopen(path.c_str(), _O_RDWR | _O_BINARY);     // path is wide on windows
+    if (fd < 0){
+        io_count.errors++;
+        return false;
+    }
+    io_count.fsyncs++;
+    bool synced = _commit(fd) == 0;
+    _close(fd);
+#else
+    io_count.opens++;
+    int fd = open(path.c_str(), is_directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+    if (fd < 0){
+        io_count.errors++;
+        return false;
+    }
+    io_count.fsyncs++;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+#endif
+    if ( ! synced ) io_count.errors++;
+    return synced;
+}
+
+
+vector<asset_job_result> stage_assets_in_parallel(const std::filesystem::path& config_root, const vector<size_t>& jobs, const folder_owner& owner){ // writes every job to its ".installing" file, so the install takes about as long as the slowest file
+    vector<asset_job_result> results(jobs.size());
+
+    run_in_parallel(jobs.size(), [&](size_t i){
+        const embedded_asset& asset = embedded_assets[jobs[i]];
+        results[i].file_name = asset.name;
+        scoped_timer timer("write " + results[i].file_name, "asset", &results[i].milliseconds);
+        error_code error = write_asset(asset, staged_path_of(config_root / asset.relative_path));
+        if ( ! error ){
+            error = give_to_owner(staged_path_of(config_root / asset.relative_path), owner);   // before the rename, so the file never shows up owned by root
+        }
+        results[i].written = ! error;
+        if (error){
+            results[i].error = error.message();
+        }
+    });
+    return results;                         // printing happens afterwards on the main thread so lines don't get mixed up
+}
+
+
+bool sync_staged_assets(const std::filesystem::path& config_root, const vector<size_t>& jobs){ // one batched fsync pass over all staged files instead of flushing each one while it is written
+    scoped_timer timer("sync", "install");
+    atomic<bool> all_synced{true};
+    run_in_parallel(jobs.size(), [&](size_t i){
+        if ( ! sync_to_disk(staged_path_of(config_root / embedded_assets[jobs[i]].relative_path)) ){
+            all_synced = false;
+        }
+    });
+    return all_synced;
+}
+
+
+void discard_staged_extras(const std::filesystem::path& config_root){ // the manifest and the helper are staged the same way but aren't embedded assets
+    error_code error;
+    std::filesystem::remove(staged_path_of(config_root / manifest_relative_path), error);
+    std::filesystem::remove(staged_path_of(config_root / helper_relative_path), error);
+}
+
+
+void discard_staged_assets(const std::filesystem::path& config_root, const vector<size_t>& jobs){ // removes the ".installing" leftovers, the live files were never touched
+    error_code error;
+    for (size_t job : jobs){
+        std::filesystem::remove(staged_path_of(config_root / embedded_assets[job].relative_path), error);
+    }
+    discard_staged_extras(config_root);
+}
+
+
+bool keep_backup_of(const std::filesystem::path& target_path, error_code& error){ // gives the live file its ".previous" name too, without moving it away
+    std::filesystem::path backup_path = backup_path_of(target_path);
+    std::filesystem::remove(backup_path, error);
+    std::filesystem::create_hard_link(target_path, backup_path, error);
+    if (error){                             // FAT32, some network shares... no hard links there, so a real copy
+        io_count.opens += 2;
+        std::filesystem::copy_file(target_path, backup_path, std::filesystem::copy_options::overwrite_existing, error);
+        if (error) io_count.errors++;
+    }
+    return ! error;
+}
+
+
+bool commit_staged_assets(const std::filesystem::path& config_root, const vector<size_t>& jobs){ // renames every staged file over its target. if any rename fails, the previous files are put back
+    scoped_timer timer("commit", "install");
+    vector<bool> had_previous_file(jobs.size(), false);
+    size_t committed = 0;
+    error_code error;
+
+    for (; committed < jobs.size(); committed++){
+        std::filesystem::path target_path = config_root / embedded_assets[jobs[committed]].relative_path;
+
+        had_previous_file[committed] = std::filesystem::exists(target_path, error);
+        if (had_previous_file[committed] && ! keep_backup_of(target_path, error)) break;
+        rename_file(staged_path_of(target_path), target_path, error);
+        if (error){
+            error_code ignored;
+            std::filesystem::remove(backup_path_of(target_path), ignored);     // the live file was never replaced
+            break;
+        }
+    }
+
+    if (committed < jobs.size()){           // rollback, newest first
+        for (size_t i = committed; i-- > 0; ){
+            std::filesystem::path target_path = config_root / embedded_assets[jobs[i]].relative_path;
+            error_code ignored;
+            if (had_previous_file[i]){
+                rename_file(backup_path_of(target_path), target_path, ignored);
+            }
+            else{
+                std::filesystem::remove(target_path, ignored);
+            }
+        }
+        discard_staged_assets(config_root, jobs);
+        return false;
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++){ // everything is in place, the old files aren't needed anymore
+        if (had_previous_file[i]){
+            std::filesystem::remove(backup_path_of(config_root / embedded_assets[jobs[i]].relative_path), error);
+        }
+    }
+    for (const string& directory : target_directories){
+        sync_to_disk(config_root / directory, true);   // makes the renames themselves durable
+    }
+    return true;
+}
+
+
+bool recover_interrupted_install(const std::filesystem::path& config_root){ // an install killed halfway leaves ".previous" and ".installing" files. the old file goes back, the staged one is dropped. true if anything was put back
+    error_code error;
+    bool restored = false;
+    for (const embedded_asset& asset : embedded_assets){
+        std::filesystem::path target_path = config_root / asset.relative_path;
+        if (std::filesystem::exists(backup_path_of(target_path), error)){
+            rename_file(backup_path_of(target_path), target_path, error);       // the commit never finished, so the whole tree goes back to the old files
+            restored = true;
+        }
+        std::filesystem::remove(staged_path_of(target_path), error);
+    }
+    discard_staged_extras(config_root);
+    if (restored){
+        for (const string& directory : target_directories){
+            sync_to_disk(config_root / directory, true);
+        }
+    }
+    return restored;
+}
+
+
+
+// the native helper: the installer also copies itself into the config folder as bin/mpv_config.
+// autoload.lua runs it as "mpv_config --index-dir DIR INDEX MTIME" to get a folder sorted (see run_directory_indexer),
+// which is a lot faster than sorting thousands of names in lua. it is only copied again when this exe changed.
+
+std::filesystem::path installer_path;       // this exe, filled in by main. empty if it couldn't be found
+
+
+std::filesystem::path own_executable_path(const char* argv0){ // argv[0] can be a bare name found through PATH, so ask the system first
+    error_code error;
+#ifdef _WIN32
+    vector<wchar_t> buffer(32768);
+    DWORD length = GetModuleFileNameW(nullptr, buffer.data(), (DWORD)buffer.size());
+    if (length > 0 && length < buffer.size()) return std::filesystem::path(wstring(buffer.data(), length));
+#else
+    std::filesystem::path self = std::filesystem::read_symlink("/proc/self/exe", error);
+    if ( ! error ) return self;
+#endif
+    std::filesystem::path guess = std::filesystem::absolute(argv0, error);
+    if (error || ! std::filesystem::is_regular_file(guess, error)) return {};
+    return guess;
+}
+
+
+bool install_native_helper(const std::filesystem::path& config_root, const folder_owner& owner){ // copy, then rename over the old one, like every other file
+    if (installer_path.empty()) return false;
+    std::filesystem::path target = config_root / helper_relative_path;
+    error_code error, target_error;
+
+    if (std::filesystem::equivalent(installer_path, target, target_error)) return true;    // running the helper itself
+    uintmax_t size = std::filesystem::file_size(installer_path, error);
+    if (error) return false;
+    if (std::filesystem::file_size(target, target_error) == size && ! target_error
+        && std::filesystem::last_write_time(target, target_error) >= std::filesystem::last_write_time(installer_path, error)
+        && ! target_error && ! error){
+        return true;                        // copy_file gives the copy a newer time, so this is the copy we made last time
+    }
+
+    std::filesystem::path staged_path = staged_path_of(target);
+    io_count.opens += 2;
+    std::filesystem::copy_file(installer_path, staged_path, std::filesystem::copy_options::overwrite_existing, error);
+    if ( ! error ){
+        io_count.bytes_written += size;
+        error = give_to_owner(staged_path, owner);
+    }
+    if ( ! error ){
+        rename_file(staged_path, target, error);
+    }
+    if (error){
+        io_count.errors++;
+        std::filesystem::remove(staged_path, target_error);
+        return false;
+    }
+    return true;
+}
+
+
+struct install_result{                      // everything one install did, so it can be printed for a person or for a script
+    bool installed = false;
+    string error;                           // why it failed, empty if it didn't
+    vector<asset_job_result> written;       // only the files that had changed
+    size_t skipped_files = 0;
+    uintmax_t skipped_bytes = 0;
+    bool helper_installed = false;          // bin/mpv_config. without it autoload.lua just sorts by itself
+    bool recovered = false;                 // an earlier install was interrupted and its old files were put back first
+    double milliseconds = 0;
+};
+
+
+void run_install_steps(const std::filesystem::path& config_root, const folder_owner& owner, install_result& result){ // folders, compare, stage, sync, rename, manifest, helper
+    if ( ! make_target_directories(config_root, owner) ){
+        result.error = "could not create the mpv folders";
+        return;
+    }
+    result.recovered = recover_interrupted_install(config_root);
+
+    vector<size_t> changed_jobs = find_changed_assets(config_root, result.skipped_bytes);
+    result.skipped_files = asset_count - changed_jobs.size();
+    result.written = stage_assets_in_parallel(config_root, changed_jobs, owner);
+
+    for (const asset_job_result& written : result.written){
+        if ( ! written.written ){
+            result.error = "could not create " + written.file_name + " (" + written.error + ")";
+        }
+    }
+    if (result.error.empty() && ! sync_staged_assets(config_root, changed_jobs)){
+        result.error = "could not sync the new files to disk";
+    }
+    if (result.error.empty() && ! commit_staged_assets(config_root, changed_jobs)){
+        result.error = "could not move the new files into place";
+    }
+
+    if (result.error.empty()){
+        result.installed = true;
+        write_manifest(config_root, owner);  // if this fails the next run just compares every file again
+        result.helper_installed = install_native_helper(config_root, owner);
+    }
+    else{
+        discard_staged_assets(config_root, changed_jobs);
+    }
+}
+
+
+install_result install_config(const std::filesystem::path& config_root, const std::filesystem::path& home = {}){ // the whole install for one mpv config folder. the new files belong to whoever owns home (or the nearest folder above config_root)
+    install_result result;
+    {
+        scoped_timer timer("install " + config_root.string(), "install", &result.milliseconds);
+        run_install_steps(config_root, owner_of_folder(home.empty() ? config_root : home), result);
+    }                                       // the timer has filled in result.milliseconds here
+    return result;
+}
+
+
+
+// where the config goes. mpv looks in a different place depending on the system:
+//     windows            C:\Users\username\AppData\Roaming\mpv   (%APPDATA%\mpv for the user running this)
+//     linux and others   $XDG_CONFIG_HOME/mpv, or ~/.config/mpv when that isn't set
+//     portable mpv       the portable_config folder next to mpv.exe
+// "--root DIR" skips all of this and installs straight into DIR, like a staging tree or a tmpfs used for baking images.
+
+std::filesystem::path home_folder_of(const string& username){ // home folder of any user on this machine
+#ifdef _WIN32
+    return std::filesystem::path("C:\\Users") / username;      // looks something like "C:\Users\jhonny_D" or "C:\Users\Koby"
+#else
+    return std::filesystem::path("/home") / username;
+#endif
+}
+
+
+std::filesystem::path config_root_in_home(const std::filesystem::path& home){
+#ifdef _WIN32
+    return home / "AppData" / "Roaming" / "mpv";
+#else
+    return home / ".config" / "mpv";        // another user's XDG_CONFIG_HOME can't be known from here, so the default
+#endif
+}
+
+
+std::filesystem::path config_root_of_current_user(){ // empty if the environment doesn't say where home is
+#ifdef _WIN32
+    const char* appdata = getenv("APPDATA");
+    if (appdata && *appdata) return std::filesystem::path(appdata) / "mpv";
+    const char* home = getenv("USERPROFILE");
+#else
+    const char* xdg_config_home = getenv("XDG_CONFIG_HOME");
+    if (xdg_config_home && std::filesystem::path(xdg_config_home).is_absolute()){ // relative values are invalid and ignored, says the XDG spec
+        return std::filesystem::path(xdg_config_home) / "mpv";
+    }
+    const char* home = getenv("HOME");
+#endif
+    if (home && *home) return config_root_in_home(home);
+    return {};
+}
+
+
+std::filesystem::path portable_config_root(const std::filesystem::path& mpv_folder){
+    return mpv_folder / "portable_config";
+}
+
+
+int print_install(const std::filesystem::path& config_root){ // installs and prints the result for a person to read. returns the exit code
+    install_result result = install_config(config_root);
+
+    if (result.recovered){
+        cout<<"(the last install into this folder was interrupted, its old files were put back first)"<<'\n';
+    }
+
+    for (const asset_job_result& written : result.written){
+        if ( ! written.written ){
+            cout<<"Could not create "<<written.file_name<<"! ("<<written.error<<")"<<'\n';
+        }
+        else if (result.installed){         // a staged file only counts once the whole commit went through
+            cout<<"successfully created "<<written.file_name<<"... ("<<written.milliseconds<<" ms)"<<'\n';
+        }
+    }
+
+    if (result.installed){
+        cout<<'\n'<<"installed "<<result.written.size()<<" files into "<<config_root.string()<<" in "<<result.milliseconds<<" ms, "
+            <<"skipped "<<result.skipped_files<<" unchanged files ("<<result.skipped_bytes<<" bytes)"<<endl<<endl;
+        if ( ! result.helper_installed ){
+            cout<<"(could not copy this program to "<<(config_root / helper_relative_path).string()<<", autoload.lua will sort folders by itself)"<<endl<<endl;
+        }
+        return 0;
+    }
+    cout<<'\n'<<"install failed ("<<result.error<<"), the previous mpv config was left as it was"<<endl<<endl;
+    return 1;
+}
+
+
+// batch mode: "mpv_config --batch profiles.txt" (or "--batch -" to read stdin) installs into many user folders in one go, without asking anything.
+// every line is a username or a full home folder path. empty lines and lines starting with # are skipped.
+// prints one json object per profile and a last one with the totals, and exits with 1 if any profile failed.
+
+std::filesystem::path profile_home_path(const string& profile){ // a username becomes its home folder, a path is used as it is
+    if (profile.find_first_of("\\/:") == string::npos){
+        return home_folder_of(profile);
+    }
+    return profile;
+}
+
+
+vector<string> read_profile_list(istream& list_reader){
+    vector<string> profiles;
+    string line;
+    while (getline(list_reader, line)){
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        profiles.push_back(line.substr(first, last - first + 1));
+    }
+    return profiles;
+}
+
+
+int run_batch(const string& list_path){
+    vector<string> profiles;
+    if (list_path == "-"){
+        profiles = read_profile_list(cin);
+    }
+    else{
+        ifstream list_reader( list_path );
+        if ( ! list_reader.is_open() ){
+            cout<<"{\"error\":\"could not open "<<json_escape(list_path)<<"\"}"<<endl;
+            return 1;
+        }
+        profiles = read_profile_list(list_reader);
+    }
+
+    auto batch_started = chrono::steady_clock::now();
+    vector<std::filesystem::path> home_paths(profiles.size());
+    vector<char> home_exists(profiles.size(), false);
+    run_in_parallel(profiles.size(), [&](size_t i){     // checking the folders is mostly waiting on the disk (or network), so all at once
+        home_paths[i] = profile_home_path(profiles[i]);
+        error_code error;
+        home_exists[i] = std::filesystem::is_directory(home_paths[i], error);
+    });
+
+    vector<install_result> results(profiles.size());
+    run_in_parallel(profiles.size(), [&](size_t i){     // one profile per worker, each install runs its own steps one after another
+        if (home_exists[i]){
+            results[i] = install_config(config_root_in_home(home_paths[i]), home_paths[i]);
+        }
+        else{
+            results[i].error = "home folder does not exist";
+        }
+    });
+
+    size_t installed = 0;
+    for (size_t i = 0; i < profiles.size(); i++){
+        const install_result& result = results[i];
+        if (result.installed) installed++;
+        cout<<"{\"profile\":\""<<json_escape(profiles[i])<<"\",\"home\":\""<<json_escape(home_paths[i].string())<<"\","
+            <<"\"config\":\""<<json_escape(config_root_in_home(home_paths[i]).string())<<"\","
+            <<"\"status\":\""<<(result.installed ? "installed" : "failed")<<"\","
+            <<"\"written\":"<<(result.installed ? result.written.size() : 0)<<",\"skipped\":"<<result.skipped_files<<","
+            <<"\"skipped_bytes\":"<<result.skipped_bytes<<",\"ms\":"<<result.milliseconds;
+        if (result.recovered){
+            cout<<",\"recovered\":true";
+        }
+        if ( ! result.error.empty() ){
+            cout<<",\"error\":\""<<json_escape(result.error)<<"\"";
+        }
+        cout<<"}"<<'\n';
+    }
+    double batch_milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - batch_started).count();
+    cout<<"{\"profiles\":"<<profiles.size()<<",\"installed\":"<<installed<<",\"failed\":"<<profiles.size() - installed
+        <<",\"ms\":"<<batch_milliseconds<<"}"<<endl;
+    return installed == profiles.size() ? 0 : 1;
+}
+
+
+// --bench-write N: writes every asset N times with the old ofstream way and with write_file_raw, into a temp folder,
+// and prints the median time of both. only the writing is timed, the unpacking is done once before.
+
+double percentile(vector<double> values, double fraction){ // fraction 0.5 is the median, 0.99 is p99
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+    return values[min(index, values.size() - 1)];
+}
+
+
+int run_write_benchmark(int rounds){
+    error_code error;
+    std::filesystem::path bench_folder = std::filesystem::temp_directory_path(error) / "mpv_config_bench_write";
+    std::filesystem::create_directories(bench_folder, error);
+    if (error){
+        cout<<"could not create "<<bench_folder.string()<<endl;
+        return 1;
+    }
+
+    cout<<left<<setw(18)<<"asset"<<right<<setw(10)<<"bytes"<<setw(16)<<"ofstream us"<<setw(16)<<"raw us"<<setw(10)<<"speedup"<<'\n';
+    cout<<fixed<<setprecision(1);
+    for (const embedded_asset& asset : embedded_assets){
+        string contents = file_contents_of(asset);
+        std::filesystem::path file_path = bench_folder / asset.name;
+        vector<double> ofstream_times, raw_times;
+
+        for (int round = 0; round < rounds; round++){
+            for (int way = 0; way < 2; way++){      // alternates which one goes first, so neither always gets the warm cache
+                bool use_raw = (way + round) % 2 == 1;
+                auto started = chrono::steady_clock::now();
+                bool written = use_raw ? ! write_file_raw(file_path, contents) : write_file_with_ofstream(file_path, contents);
+                double microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+                if ( ! written ){
+                    cout<<"could not write "<<file_path.string()<<endl;
+                    std::filesystem::remove_all(bench_folder, error);
+                    return 1;
+                }
+                (use_raw ? raw_times : ofstream_times).push_back(microseconds);
+            }
+        }
+
+        double ofstream_median = percentile(ofstream_times, 0.5), raw_median = percentile(raw_times, 0.5);
+        cout<<left<<setw(18)<<asset.name<<right<<setw(10)<<contents.size()<<setw(16)<<ofstream_median<<setw(16)<<raw_median
+            <<setw(9)<<(raw_median > 0 ? ofstream_median / raw_median : 0)<<"x"<<'\n';
+    }
+    cout<<flush;
+    std::filesystem::remove_all(bench_folder, error);
+    return 0;
+}
+
+
+// --bench N [DIR]: runs the whole install N times into DIR/mpv_config_bench (DIR is a temp folder if not given), emptying it before
+// every round so every file really gets written. prints p50/p99 for each asset and for the whole install, and the bytes and
+// file operations (io_count) per install. point DIR at a network home folder to see what the install costs there.
+
+int run_install_benchmark(int rounds, std::filesystem::path bench_folder){
+    error_code error;
+    if (bench_folder.empty()){
+        bench_folder = std::filesystem::temp_directory_path(error);
+    }
+    std::filesystem::path bench_root = bench_folder / "mpv_config_bench";  // only this folder is ever emptied, never DIR itself
+
+    vector<vector<double>> asset_times(asset_count);
+    vector<double> install_times;
+    uint64_t opens = io_count.opens, writes = io_count.writes, fsyncs = io_count.fsyncs;
+    uint64_t renames = io_count.renames, bytes_written = io_count.bytes_written;
+
+    for (int round = 0; round < rounds; round++){
+        std::filesystem::remove_all(bench_root, error);       // not timed
+        install_result result = install_config(bench_root);
+        if ( ! result.installed ){
+            cout<<"install into "<<bench_root.string()<<" failed: "<<result.error<<endl;
+            std::filesystem::remove_all(bench_root, error);
+            return 1;
+        }
+        install_times.push_back(result.milliseconds);
+        for (const asset_job_result& written : result.written){
+            asset_times[find_asset(written.file_name.c_str())].push_back(written.milliseconds);
+        }
+    }
+    std::filesystem::remove_all(bench_root, error);
+
+    cout<<rounds<<" installs into "<<bench_root.string()<<'\n'<<'\n';
+    cout<<left<<setw(18)<<"asset"<<right<<setw(10)<<"bytes"<<setw(12)<<"p50 ms"<<setw(12)<<"p99 ms"<<'\n';
+    cout<<fixed<<setprecision(3);
+    for (size_t i = 0; i < asset_count; i++){
+        cout<<left<<setw(18)<<embedded_assets[i].name<<right<<setw(10)<<embedded_assets[i].size
+            <<setw(12)<<percentile(asset_times[i], 0.5)<<setw(12)<<percentile(asset_times[i], 0.99)<<'\n';
+    }
+    cout<<left<<setw(28)<<"whole install"<<right<<setw(12)<<percentile(install_times, 0.5)<<setw(12)<<percentile(install_times, 0.99)<<'\n'<<'\n';
+
+    double per_install = 1.0 / rounds;
+    cout<<setprecision(1)<<"per install: "<<(io_count.opens - opens) * per_install<<" opens, "<<(io_count.writes - writes) * per_install<<" writes, "
+        <<(io_count.fsyncs - fsyncs) * per_install<<" fsyncs, "<<(io_count.renames - renames) * per_install<<" renames, "
+        <<setprecision(0)<<(io_count.bytes_written - bytes_written) * per_install<<" bytes written"<<endl;
+    return 0;
+}
+
+
+// --index-dir DIR INDEX MTIME: what autoload.lua runs through bin/mpv_config. writes the files of DIR, sorted the way
+// autoload.lua's alnumcomp sorts them, to INDEX. the first lines are a header, MTIME (the folder's modified time as lua saw it)
+// and DIR, so the script can tell if the index is still good for that folder. every key is built once before sorting.
+
+const string index_header = "mpv_config index 1";
+
+struct natural_key_part{                    // a run of digits, or a run of anything else
+    bool is_number;
+    double number;
+    string text;                            // for a number, how lua's tostring prints it. used when the other side is text
+};
+
+
+vector<natural_key_part> natural_key(const string& name){ // clean_key and splitbynum from autoload.lua
+    string cleaned;                         // whitespace runs become one space, none at the ends, and lower case
+    for (char c : name){
+        if (isspace((unsigned char)c)){
+            if ( ! cleaned.empty() && cleaned.back() != ' ') cleaned += ' ';
+        }
+        else{
+            cleaned += (char)tolower((unsigned char)c);
+        }
+    }
+    if ( ! cleaned.empty() && cleaned.back() == ' ') cleaned.pop_back();
+
+    vector<natural_key_part> key;
+    size_t i = 0;
+    while (i < cleaned.size()){
+        bool digits = isdigit((unsigned char)cleaned[i]);
+        size_t end = i;
+        while (end < cleaned.size() && (bool)isdigit((unsigned char)cleaned[end]) == digits) end++;
+        natural_key_part part{ digits, 0, cleaned.substr(i, end - i) };
+        if (digits){
+            part.number = strtod(part.text.c_str(), nullptr);  // lua's tonumber, so "007" is 7 and huge runs lose digits the same way
+            char printed[32];
+            snprintf(printed, sizeof printed, "%.14g", part.number);
+            part.text = printed;
+        }
+        key.push_back(move(part));
+        i = end;
+    }
+    return key;
+}
+
+
+bool natural_less(const vector<natural_key_part>& x, const vector<natural_key_part>& y){ // alnumcomp from autoload.lua
+    for (size_t i = 0; i < min(x.size(), y.size()); i++){
+        if (x[i].is_number && y[i].is_number){
+            if (x[i].number != y[i].number) return x[i].number < y[i].number;
+        }
+        else if (x[i].text != y[i].text){
+            return x[i].text < y[i].text;   // byte order, like lua's < in the C locale mpv runs in
+        }
+    }
+    return x.size() < y.size();
+}
+
+
+vector<string> utf8_arguments(int argc, char* argv[]){ // mpv passes the folder as utf-8, windows turns char* arguments into the ANSI codepage
+#ifdef _WIN32
+    int count = 0;
+    LPWSTR* wide = CommandLineToArgvW(GetCommandLineW(), &count);
+    if (wide && count >= argc){
+        vector<string> arguments;
+        for (int i = count - argc; i < count; i++){    // the last argc ones, in case --trace was taken off the front
+            int size = WideCharToMultiByte(CP_UTF8, 0, wide[i], -1, nullptr, 0, nullptr, nullptr);
+            string argument(size > 0 ? size - 1 : 0, '\0');
+            if (size > 1) WideCharToMultiByte(CP_UTF8, 0, wide[i], -1, &argument[0], size, nullptr, nullptr);
+            arguments.push_back(argument);
+        }
+        LocalFree(wide);
+        return arguments;
+    }
+    if (wide) LocalFree(wide);
+#endif
+    return vector<string>(argv, argv + argc);
+}
+
+
+int run_directory_indexer(const string& folder, const string& index_file, const string& modified_time){ // returns the exit code
+    vector<pair<vector<natural_key_part>, string>> files;  // key first, the sort only compares
+    error_code error;
+    std::filesystem::directory_iterator entry(std::filesystem::u8path(folder), error);
+    for (; ! error && entry != std::filesystem::directory_iterator(); entry.increment(error)){
+        error_code type_error;
+        if ( ! entry->is_regular_file(type_error) ) continue;      // same as utils.readdir(dir, "files")
+        string name = entry->path().filename().u8string();
+        if (name.find('\n') != string::npos) continue;             // can't be a line of the index
+        files.push_back({ natural_key(name), move(name) });
+    }
+    if (error){
+        cerr<<"could not read "<<folder<<" ("<<error.message()<<")"<<endl;
+        return 1;
+    }
+
+    sort(files.begin(), files.end(), [](const auto& a, const auto& b){
+        if (natural_less(a.first, b.first)) return true;
+        if (natural_less(b.first, a.first)) return false;
+        return a.second < b.second;         // same key, like "A.mkv" and "a.mkv": keep the order the same every time
+    });
+
+    string index = index_header + '\n' + modified_time + '\n' + folder + '\n';
+    for (const auto& file : files){
+        index += file.second;
+        index += '\n';
+    }
+
+    std::filesystem::path index_path = std::filesystem::u8path(index_file);
+    std::filesystem::path staged_path = staged_path_of(index_path);
+    std::filesystem::create_directories(index_path.parent_path(), error);
+    if (write_file_raw(staged_path, index)){
+        cerr<<"could not write "<<index_file<<endl;
+        return 1;
+    }
+    rename_file(staged_path, index_path, error);   // another mpv reading the index sees the old one or the new one, never half of it
+    if (error){
+        std::filesystem::remove(staged_path, error);
+        cerr<<"could not write "<<index_file<<endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// --patch-vp8-log LOG SECONDS: what webm.lua runs through bin/mpv_config between the two passes of a libvpx encode.
+// LOG is the base64 first pass log: one 144 byte FirstpassStats record per frame and a total one at the end. libvpx wants
+// the duration field (a double in 1/10000000 s, at byte 128 of a record) to add up to the length of the clip.
+// 144 bytes are exactly 192 base64 characters, so the duration of every record is in the same 16 characters of it:
+// only those are decoded, patched and encoded again, straight in the mapped file.
+
+const size_t vp8_record_size = 144;
+const size_t vp8_record_chars = vp8_record_size / 3 * 4;
+const size_t vp8_duration_offset = 128;
+const size_t vp8_duration_chars_at = vp8_duration_offset / 3 * 4;        // the 4 base64 groups holding bytes 126 to 137
+const size_t vp8_duration_in_group = vp8_duration_offset % 3;            // where the double starts in those 12 bytes
+const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+array<int, 256> base64_values(){               // -1 for anything that isn't base64
+    array<int, 256> values;
+    values.fill(-1);
+    for (int i = 0; i < 64; i++) values[(unsigned char)base64_alphabet[i]] = i;
+    return values;
+}
+
+
+bool decode_duration_groups(const char* text, unsigned char bytes[12]){ // 16 characters into 12 bytes
+    static const array<int, 256> values = base64_values();
+    for (int group = 0; group < 4; group++){
+        int v[4];
+        for (int i = 0; i < 4; i++){
+            v[i] = values[(unsigned char)text[group * 4 + i]];
+            if (v[i] < 0) return false;
+        }
+        uint32_t bits = v[0] << 18 | v[1] << 12 | v[2] << 6 | v[3];
+        bytes[group * 3] = bits >> 16;
+        bytes[group * 3 + 1] = bits >> 8 & 255;
+        bytes[group * 3 + 2] = bits & 255;
+    }
+    return true;
+}
+
+
+void encode_duration_groups(const unsigned char bytes[12], char* text){
+    for (int group = 0; group < 4; group++){
+        uint32_t bits = bytes[group * 3] << 16 | bytes[group * 3 + 1] << 8 | bytes[group * 3 + 2];
+        for (int i = 0; i < 4; i++) text[group * 4 + i] = base64_alphabet[bits >> (18 - 6 * i) & 63];
+    }
+}
+
+
+bool patch_vp8_stats(char* log, size_t size, double seconds){ // same as vp8_patch_logfile in webm.lua. false leaves log as it was
+    while (size > 0 && isspace((unsigned char)log[size - 1])) size--;
+    size_t records = size / vp8_record_chars;
+    if (size % vp8_record_chars != 0 || records < 2) return false;
+
+    unsigned char bytes[12];
+    for (size_t record = 0; record < records; record++){   // check everything first, so a bad log is never half patched
+        if ( ! decode_duration_groups(log + record * vp8_record_chars + vp8_duration_chars_at, bytes) ) return false;
+    }
+
+    double average_duration = seconds / (records - 1);
+    for (size_t record = 0; record < records; record++){
+        char* text = log + record * vp8_record_chars + vp8_duration_chars_at;
+        double duration = (record + 1 < records ? average_duration : seconds) * 10000000.0;
+        decode_duration_groups(text, bytes);
+        memcpy(bytes + vp8_duration_in_group, &duration, sizeof duration);  // the log is in the byte order of the encoder: little endian wherever mpv runs
+        encode_duration_groups(bytes, text);
+    }
+    return true;
+}
+
+
+bool patch_vp8_log_file(const std::filesystem::path& log_path, double seconds){ // maps the log and patches it in place
+    error_code error;
+    uintmax_t size = std::filesystem::file_size(log_path, error);
+    if (error || size == 0) return false;
+    io_count.opens++;
+    bool patched = false;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(log_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE){
+        io_count.errors++;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    char* text = mapping ? (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+    if (text){
+        patched = patch_vp8_stats(text, size, seconds);
+        UnmapViewOfFile(text);
+    }
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    int fd = open(log_path.c_str(), O_RDWR);
+    if (fd < 0){
+        io_count.errors++;
+        return false;
+    }
+    void* text = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (text != MAP_FAILED){
+        patched = patch_vp8_stats((char*)text, size, seconds);
+        munmap(text, size);
+    }
+    close(fd);
+#endif
+    if ( ! patched ) io_count.errors++;
+    return patched;
+}
+
+
+int run_vp8_log_patcher(const string& log_file, const string& seconds_text){ // returns the exit code
+    char* end;
+    double seconds = strtod(seconds_text.c_str(), &end);
+    if (end == seconds_text.c_str() || ! (seconds > 0)){
+        cerr<<"not a duration: "<<seconds_text<<endl;
+        return 2;
+    }
+    if ( ! patch_vp8_log_file(std::filesystem::u8path(log_file), seconds) ){
+        cerr<<"could not patch "<<log_file<<" (missing, or not a vp8 first pass log)"<<endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+// --bench-vp8-log HOURS: makes a first pass log of HOURS of 30 fps video in a temp folder and times patching it 5 times.
+// webm.lua's own version of this step can be timed with "script-message mpv-webm-benchmark".
+int run_vp8_log_benchmark(double hours){
+    size_t records = (size_t)(hours * 3600 * 30) + 1;
+    string log;
+    log.reserve(records * vp8_record_chars + 1);
+    unsigned char record[vp8_record_size];
+    for (size_t i = 0; i < records; i++){
+        for (size_t b = 0; b < vp8_record_size; b++) record[b] = (unsigned char)(i * 31 + b * 7);
+        for (size_t b = 0; b < vp8_record_size; b += 3){
+            uint32_t bits = record[b] << 16 | record[b + 1] << 8 | record[b + 2];
+            for (int c = 0; c < 4; c++) log += base64_alphabet[bits >> (18 - 6 * c) & 63];
+        }
+    }
+    log += '\n';
+
+    error_code error;
+    std::filesystem::path log_path = std::filesystem::temp_directory_path(error) / "mpv_config_bench-video-pass1.log";
+    if (error || write_file_raw(log_path, log)){
+        cout<<"could not write "<<log_path.string()<<endl;
+        return 1;
+    }
+
+    vector<double> times;
+    double seconds = hours * 3600;
+    for (int round = 0; round < 5; round++){
+        auto started = chrono::steady_clock::now();
+        if ( ! patch_vp8_log_file(log_path, seconds) ){
+            cout<<"could not patch "<<log_path.string()<<endl;
+            std::filesystem::remove(log_path, error);
+            return 1;
+        }
+        times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
+    }
+
+    ifstream patched_file(log_path, ios::binary);              // read back what the last record says
+    string patched((istreambuf_iterator<char>(patched_file)), istreambuf_iterator<char>());
+    unsigned char bytes[12];
+    double last_duration = 0;
+    if (decode_duration_groups(patched.data() + (records - 1) * vp8_record_chars + vp8_duration_chars_at, bytes)){
+        memcpy(&last_duration, bytes + vp8_duration_in_group, sizeof last_duration);
+    }
+    std::filesystem::remove(log_path, error);
+
+    cout<<fixed<<setprecision(2)<<records<<" records ("<<log.size() / 1048576.0<<" MB of base64), patched in p50 "<<percentile(times, 0.5)
+        <<" ms, p99 "<<percentile(times, 0.99)<<" ms. the last record says "<<last_duration / 10000000.0<<" s"<<endl;
+    return 0;
+}
+
+
+void print_usage(const char* program){
+    cout<<"usage: "<<program<<"                       asks for a username and installs into its mpv config folder"<<'\n'
+        <<"       "<<program<<" --root DIR            installs straight into DIR"<<'\n'
+        <<"       "<<program<<" --portable MPV_DIR    installs into MPV_DIR/portable_config"<<'\n'
+        <<"       "<<program<<" --current-user        installs into %APPDATA%\\mpv, or $XDG_CONFIG_HOME/mpv (~/.config/mpv)"<<'\n'
+        <<"       "<<program<<" --batch FILE          installs for every username or home folder in FILE (- for stdin)"<<'\n'
+        <<"       "<<program<<" --bench N [DIR]       times N whole installs into DIR/mpv_config_bench (DIR defaults to a temp folder)"<<'\n'
+        <<"       "<<program<<" --bench-write N       times N writes of every file, ofstream against the raw write path"<<'\n'
+        <<"       "<<program<<" --index-dir DIR INDEX MTIME   writes the sorted file list of DIR to INDEX (run by autoload.lua)"<<'\n'
+        <<"       "<<program<<" --patch-vp8-log LOG SECONDS   fixes the frame durations in a vp8 first pass LOG (run by webm.lua)"<<'\n'
+        <<"       "<<program<<" --bench-vp8-log HOURS         times --patch-vp8-log on a made up log of HOURS of 30 fps video"<<'\n'
+        <<"any of these can start with --trace FILE, to save the timings and io counters as chrome trace event json in FILE"<<endl;
+}
+
+
+int run_command(int argc, char* argv[]){
+    if (argc == 3 && string(argv[1]) == "--batch"){
+        return run_batch(argv[2]);                  // no questions and no pause, for login scripts
+    }
+    if (argc == 3 && string(argv[1]) == "--root"){
+        return print_install(argv[2]);
+    }
+    if (argc == 3 && string(argv[1]) == "--portable"){
+        if ( ! std::filesystem::is_directory(argv[2]) ){
+            cout<<"mpv folder "<<argv[2]<<" does not exist"<<endl;
+            return 1;
+        }
+        return print_install(portable_config_root(argv[2]));
+    }
+    if (argc == 2 && string(argv[1]) == "--current-user"){
+        std::filesystem::path config_root = config_root_of_current_user();
+        if (config_root.empty()){
+            cout<<"could not find the home folder of the current user"<<endl;
+            return 1;
+        }
+        return print_install(config_root);
+    }
+    if ((argc == 3 || argc == 4) && string(argv[1]) == "--bench" && atoi(argv[2]) > 0){
+        return run_install_benchmark(atoi(argv[2]), argc == 4 ? argv[3] : "");
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-write" && atoi(argv[2]) > 0){
+        return run_write_benchmark(atoi(argv[2]));
+    }
+    if (argc == 5 && string(argv[1]) == "--index-dir"){
+        vector<string> arguments = utf8_arguments(argc, argv);
+        return run_directory_indexer(arguments[2], arguments[3], arguments[4]);
+    }
+    if (argc == 4 && string(argv[1]) == "--patch-vp8-log"){
+        vector<string> arguments = utf8_arguments(argc, argv);
+        return run_vp8_log_patcher(arguments[2], arguments[3]);
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-vp8-log" && atof(argv[2]) > 0){
+        return run_vp8_log_benchmark(atof(argv[2]));
+    }
+    if (argc != 1){
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    string username ;
+    cout<<"Enter username : ";
+    cin>>username ;        //  please note that username is not case sensitive in windows
+    
+    std::filesystem::path filepath = home_folder_of(username);
+    bool filepathExists = std::filesystem::is_directory(filepath);  // filepathExists will return true if path really exists
+
+    if (filepathExists == true){     // don't do anything if the path exists.
+        cout<<endl<<"Correct username!"<<endl<<endl;
+        print_install(config_root_in_home(filepath));
+    }
+    else{     // don't do anything if the path don't exists.
+        cout<<"Incorrect username please try again or check username from "<<filepath.parent_path().string()<<endl<<endl;
+    }
+#ifdef _WIN32
+    system("pause");  // for a nice "press any key to continue...." and kept it open
+#endif                // a terminal on linux stays open by itself, and has no "pause" command
+    
+
+    return 0;
+}
+
+
+int main(int argc, char* argv[]){
+    installer_path = own_executable_path(argv[0]);
+    if (argc >= 3 && string(argv[1]) == "--trace"){
+        tracing = true;
+        string trace_path = argv[2];
+        argv[2] = argv[0];                          // drops "--trace FILE", the rest reads like a normal command line
+        int exit_code = run_command(argc - 2, argv + 2);
+        if (write_file_raw(trace_path, trace_json())){
+            cout<<"Could not write the trace to "<<trace_path<<endl;
+        }
+        return exit_code;
+    }
+    return run_command(argc, argv);
 }
\ No newline at end of file